@@ -23,19 +23,80 @@
 //   -90 dBm  ~ 20-40 meters (very far / noise)
 //
 // Indoors, distances are roughly halved.
+#ifndef RSSI_THRESHOLD_DEFAULT
 #define RSSI_THRESHOLD_DEFAULT -75     // Minimum RSSI to trigger detection
+#endif
 #define RSSI_CLOSE             -55     // Very close — rapid strobe
 #define RSSI_MEDIUM            -65     // Medium distance — fast blink
 #define RSSI_FAR               -75     // Far — slow blink
 
+// ============================================================
+// Wi-Fi Sniffer
+// ============================================================
+// Optional promiscuous-mode capture alongside the BLE scan. The radio is
+// time-shared with BLE by the coexistence scheduler, so BLE scanning sees
+// fewer adverts while this is on. Transmitter OUIs (universally
+// administered MACs only) and SSIDs from probe requests, probe responses
+// and beacons feed the same tracker, journal and serial output.
+#ifndef ENABLE_WIFI_SNIFFER
+#define ENABLE_WIFI_SNIFFER    false
+#endif
+#ifndef ENABLE_WIFI_SSID_MATCH
+#define ENABLE_WIFI_SSID_MATCH true    // Name patterns against SSIDs
+#endif
+#define WIFI_CHANNEL_COUNT     13      // Hop channels 1..N (11 for US units)
+#define WIFI_HOP_INTERVAL_MS   250     // Dwell per channel
+#define WIFI_QUEUE_FRAMES      128     // Callback -> loop queue (power of two)
+#ifndef WIFI_RSSI_THRESHOLD
+#define WIFI_RSSI_THRESHOLD    RSSI_THRESHOLD_DEFAULT
+#endif
+
 // ============================================================
 // Detection Tier Settings
 // ============================================================
 // Enable/disable detection tiers at compile time.
 // HIGH is always on. MEDIUM and LOW can be toggled.
+// Disabled tiers are filtered out of the company ID table at compile
+// time, along with any matcher that only reports a disabled tier.
+#ifndef ENABLE_TIER_HIGH
 #define ENABLE_TIER_HIGH       true
+#endif
+#ifndef ENABLE_TIER_MEDIUM
 #define ENABLE_TIER_MEDIUM     true
+#endif
+#ifndef ENABLE_TIER_LOW
 #define ENABLE_TIER_LOW        false   // Off by default (too many false positives)
+#endif
+
+// ============================================================
+// Detection Pipeline Stages
+// ============================================================
+// Matchers run in this order; a disabled stage is not compiled in.
+// Settings in this section and the tier/RSSI settings above can be
+// overridden per board in platformio.ini build_flags, e.g.
+// -DENABLE_MATCH_OUI=false.
+#ifndef ENABLE_MATCH_COMPANY_ID
+#define ENABLE_MATCH_COMPANY_ID   true
+#endif
+#ifndef ENABLE_MATCH_SERVICE_UUID
+#define ENABLE_MATCH_SERVICE_UUID true
+#endif
+#ifndef ENABLE_MATCH_DEVICE_NAME
+#define ENABLE_MATCH_DEVICE_NAME  true
+#endif
+#ifndef ENABLE_MATCH_OUI
+#define ENABLE_MATCH_OUI          true    // Supplementary: BLE MACs are often random
+#endif
+#ifndef ENABLE_COOLDOWN
+#define ENABLE_COOLDOWN           true    // Per-device re-alert suppression
+#endif
+
+// Cycle counts of the BLE pipeline (gate, matchers, tracker; sinks not
+// included) per advert, reported in status messages. For taking per-board
+// figures; off in normal builds.
+#ifndef MEASURE_PIPELINE_CYCLES
+#define MEASURE_PIPELINE_CYCLES false
+#endif
 
 // ============================================================
 // LED Settings
@@ -52,6 +113,18 @@
 #define STATUS_INTERVAL_MS     10000   // Status message every 10s
 #define HEARTBEAT_INTERVAL_MS  30000   // Heartbeat every 30s
 
+// ============================================================
+// Boot
+// ============================================================
+// Fast boot starts BLE scanning first; the LED boot flash and serial
+// banner run afterwards without blocking. Set false for the original
+// order (500 ms serial settle delay, banner, BLE init, blocking flash).
+#ifndef FAST_BOOT
+#define FAST_BOOT              true
+#endif
+#define BOOT_FLASH_BLINKS      3       // Boot flash: blinks at 100 ms on/off
+#define BOOT_REPORT_TIMEOUT_MS 3000    // Send boot JSON even if nothing detected
+
 // ============================================================
 // Notification Cooldown
 // ============================================================
@@ -64,4 +137,19 @@
 // ============================================================
 #define MAX_TRACKED_DEVICES    32      // Max simultaneous tracked devices
 
+// ============================================================
+// Detection Journal
+// ============================================================
+// Detections are logged to the "journal" flash partition and survive
+// reboots. Writes are batched; a full partition overwrites the oldest
+// sector. Needs partitions_journal.csv (see platformio.ini).
+#ifndef ENABLE_JOURNAL
+#define ENABLE_JOURNAL         true
+#endif
+#define JOURNAL_BATCH_RECORDS  16      // Max records per flash write (one 256 B page)
+#define JOURNAL_FLUSH_MS       10000   // Write a partial batch after this long
+#define JOURNAL_QUEUE_RECORDS  64      // Callback -> loop queue (power of two)
+#define JOURNAL_QUERY_LIMIT    200     // Max records per serial query (~2 s at 115200)
+#define JOURNAL_QUERY_CHUNK    4       // Query records sent per loop() pass (~50 ms)
+
 #endif // CONFIG_H
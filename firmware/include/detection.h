@@ -0,0 +1,416 @@
+/*
+ * ESP-GlassHole — Detection Engine
+ *
+ * Matchers and cooldown tracking, free of Arduino and BLE library types so
+ * the same code runs on the host. pipeline.h composes them into the
+ * per-advertisement pipeline.
+ *
+ * Advertisements are accessed through a small duck-typed interface:
+ *
+ *   int            rssi() const;
+ *   const uint8_t* mac() const;                        // 6 bytes
+ *   bool           companyId(uint16_t& id) const;      // mfg data present
+ *   bool           advertisesService16(uint16_t uuid) const;
+ *   bool           name(const char*& str, size_t& len) const;
+ *
+ * The firmware wraps BLEAdvertisedDevice; host tools use synthetic adverts.
+ */
+
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "glasses_database.h"
+
+// ============================================================
+// Detection Result
+// ============================================================
+
+// Which matcher(s) fired, stored in the journal
+#define REASON_COMPANY_ID    0x01
+#define REASON_SERVICE_UUID  0x02
+#define REASON_DEVICE_NAME   0x04
+#define REASON_OUI_PREFIX    0x08
+#define REASON_WIFI          0x10   // Source, not a matcher: Wi-Fi sniffer
+
+#define COMPANY_INDEX_NONE   0xFF   // Match did not come from GLASSES_COMPANY_IDS
+
+struct DetectionResult {
+    bool        detected;
+    const char* company;
+    const char* product;
+    const char* reason;
+    bool        hasCamera;
+    uint8_t     tier;
+    uint8_t     companyIndex;   // Index into GLASSES_COMPANY_IDS
+    uint8_t     reasons;        // REASON_* bits
+    char        reasonBuf[128];
+};
+
+// ============================================================
+// Compile-Time Company ID Table
+// ============================================================
+// GLASSES_COMPANY_IDS reduced to the enabled tiers and sorted by ID, built
+// by the compiler. Lookups binary-search this copy only, so entries of
+// disabled tiers (and the full table) never reach flash.
+
+#define TIER_BIT(t) (1u << (t))
+
+constexpr uint8_t ALL_TIERS_MASK = TIER_BIT(TIER_HIGH) | TIER_BIT(TIER_MEDIUM) | TIER_BIT(TIER_LOW);
+
+constexpr uint8_t CONFIG_TIER_MASK =
+    (ENABLE_TIER_HIGH   ? TIER_BIT(TIER_HIGH)   : 0) |
+    (ENABLE_TIER_MEDIUM ? TIER_BIT(TIER_MEDIUM) : 0) |
+    (ENABLE_TIER_LOW    ? TIER_BIT(TIER_LOW)    : 0);
+
+constexpr bool tierEnabled(uint8_t tier) { return (CONFIG_TIER_MASK & TIER_BIT(tier)) != 0; }
+
+static_assert(GLASSES_COMPANY_ID_COUNT < COMPANY_INDEX_NONE,
+              "company index must fit in a uint8_t");
+
+struct CompanyEntry {
+    GlassesCompanyID info;
+    uint8_t          index;   // Position in GLASSES_COMPANY_IDS (journal records)
+};
+
+template <uint8_t TierMask>
+struct CompanyTable {
+    static constexpr size_t countEnabled() {
+        size_t n = 0;
+        for (int i = 0; i < GLASSES_COMPANY_ID_COUNT; i++) {
+            if (TierMask & TIER_BIT(GLASSES_COMPANY_IDS[i].tier)) n++;
+        }
+        return n;
+    }
+
+    static constexpr size_t SIZE = countEnabled();
+
+    struct Entries {
+        CompanyEntry e[SIZE ? SIZE : 1];
+    };
+
+    // Stable insertion sort: with duplicate IDs the first enabled entry
+    // wins, as in the database order
+    static constexpr Entries build() {
+        Entries out = {};
+        size_t n = 0;
+        for (int i = 0; i < GLASSES_COMPANY_ID_COUNT; i++) {
+            const GlassesCompanyID& entry = GLASSES_COMPANY_IDS[i];
+            if (!(TierMask & TIER_BIT(entry.tier))) continue;
+            size_t j = n++;
+            while (j > 0 && out.e[j - 1].info.id > entry.id) {
+                out.e[j] = out.e[j - 1];
+                j--;
+            }
+            out.e[j] = CompanyEntry{ entry, (uint8_t)i };
+        }
+        return out;
+    }
+
+    static constexpr Entries ENTRIES = build();
+
+    static const CompanyEntry* find(uint16_t id) {
+        size_t lo = 0, hi = SIZE;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (ENTRIES.e[mid].info.id < id) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == SIZE || ENTRIES.e[lo].info.id != id) return nullptr;
+        return &ENTRIES.e[lo];
+    }
+
+    // Reverse of CompanyEntry::index
+    static const CompanyEntry* byIndex(uint8_t index) {
+        for (size_t i = 0; i < SIZE; i++) {
+            if (ENTRIES.e[i].index == index) return &ENTRIES.e[i];
+        }
+        return nullptr;
+    }
+};
+
+// ============================================================
+// Compile-Time OUI Table
+// ============================================================
+// GLASSES_OUI_PREFIXES packed into sorted 24-bit keys, plus a bitmap of
+// first octets. Most MACs (and every locally administered one) fail the
+// bitmap test without touching the key table, which matters on the
+// Wi-Fi path where every frame is checked.
+
+struct OuiEntry {
+    uint32_t    key;      // OUI as 0x00AABBCC
+    const char* vendor;
+};
+
+constexpr uint32_t ouiKey(const uint8_t* oui) {
+    return ((uint32_t)oui[0] << 16) | ((uint32_t)oui[1] << 8) | oui[2];
+}
+
+struct OuiEntries {
+    OuiEntry e[GLASSES_OUI_PREFIX_COUNT ? GLASSES_OUI_PREFIX_COUNT : 1];
+};
+
+struct OuiFirstOctets {
+    uint32_t bits[8];
+};
+
+constexpr OuiEntries buildOuiEntries() {
+    OuiEntries out = {};
+    for (int i = 0; i < GLASSES_OUI_PREFIX_COUNT; i++) {
+        OuiEntry entry = { ouiKey(GLASSES_OUI_PREFIXES[i].oui), GLASSES_OUI_PREFIXES[i].vendor };
+        int j = i;
+        while (j > 0 && out.e[j - 1].key > entry.key) {
+            out.e[j] = out.e[j - 1];
+            j--;
+        }
+        out.e[j] = entry;
+    }
+    return out;
+}
+
+constexpr OuiFirstOctets buildOuiFirstOctets() {
+    OuiFirstOctets out = {};
+    for (int i = 0; i < GLASSES_OUI_PREFIX_COUNT; i++) {
+        uint8_t b = GLASSES_OUI_PREFIXES[i].oui[0];
+        out.bits[b >> 5] |= 1u << (b & 31);
+    }
+    return out;
+}
+
+struct OuiTable {
+    static constexpr size_t         SIZE = GLASSES_OUI_PREFIX_COUNT;
+    static constexpr OuiEntries     ENTRIES = buildOuiEntries();
+    static constexpr OuiFirstOctets FIRST_OCTETS = buildOuiFirstOctets();
+
+    // False means no entry can match; true needs find() to confirm
+    static bool maybe(const uint8_t* mac) {
+        return (FIRST_OCTETS.bits[mac[0] >> 5] >> (mac[0] & 31)) & 1;
+    }
+
+    static const OuiEntry* find(const uint8_t* mac) {
+        if (!maybe(mac)) return nullptr;
+        uint32_t key = ouiKey(mac);
+        size_t lo = 0, hi = SIZE;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (ENTRIES.e[mid].key < key) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == SIZE || ENTRIES.e[lo].key != key) return nullptr;
+        return &ENTRIES.e[lo];
+    }
+};
+
+// ============================================================
+// Compile-Time Name Pattern Table
+// ============================================================
+// The first two letters of every GLASSES_NAME_PATTERNS entry as a 32x32
+// bitmap, folded to case with & 0x1F. A name in which no such pair occurs
+// cannot match, so most names skip the substring search; the Wi-Fi
+// callback runs it on every SSID.
+
+// Case-insensitive substring search. Needles in the database are lowercase.
+inline bool containsIgnoreCase(const char* haystack, size_t len, const char* needle) {
+    size_t n = strlen(needle);
+    if (n == 0) return true;
+    if (n > len) return false;
+    for (size_t i = 0; i + n <= len; i++) {
+        size_t j = 0;
+        while (j < n) {
+            char c = haystack[i + j];
+            if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            if (c != needle[j]) break;
+            j++;
+        }
+        if (j == n) return true;
+    }
+    return false;
+}
+
+struct NamePairs {
+    uint32_t bits[32];
+};
+
+constexpr NamePairs buildNamePairs() {
+    NamePairs out = {};
+    for (int i = 0; GLASSES_NAME_PATTERNS[i].pattern != NULL; i++) {
+        const char* p = GLASSES_NAME_PATTERNS[i].pattern;
+        if (p[0] == 0 || p[1] == 0) {
+            // Shorter than a pair: nothing can be ruled out
+            for (int a = 0; a < 32; a++) out.bits[a] = ~0u;
+            continue;
+        }
+        out.bits[p[0] & 0x1F] |= 1u << (p[1] & 0x1F);
+    }
+    return out;
+}
+
+struct NameTable {
+    static constexpr NamePairs PAIRS = buildNamePairs();
+
+    // False means no pattern can match; true needs find() to confirm
+    static bool maybe(const char* name, size_t len) {
+        for (size_t i = 0; i + 1 < len; i++) {
+            if ((PAIRS.bits[name[i] & 0x1F] >> (name[i + 1] & 0x1F)) & 1) return true;
+        }
+        return false;
+    }
+
+    // First pattern in database order contained in name
+    static const GlassesNamePattern* find(const char* name, size_t len) {
+        if (!maybe(name, len)) return nullptr;
+        for (int i = 0; GLASSES_NAME_PATTERNS[i].pattern != NULL; i++) {
+            if (containsIgnoreCase(name, len, GLASSES_NAME_PATTERNS[i].pattern)) {
+                return &GLASSES_NAME_PATTERNS[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+// ============================================================
+// Matchers
+// ============================================================
+
+// Check company ID against the enabled tiers of the database
+template <uint8_t TierMask = CONFIG_TIER_MASK>
+bool checkCompanyID(uint16_t companyId, DetectionResult& result) {
+    const CompanyEntry* match = CompanyTable<TierMask>::find(companyId);
+    if (!match) return false;
+
+    const GlassesCompanyID& entry = match->info;
+    result.detected = true;
+    result.company = entry.company;
+    result.product = entry.product;
+    result.hasCamera = entry.hasCamera;
+    result.tier = entry.tier;
+    result.companyIndex = match->index;
+    result.reasons |= REASON_COMPANY_ID;
+    snprintf(result.reasonBuf, sizeof(result.reasonBuf),
+             "Company ID 0x%04X (%s)", companyId, entry.company);
+    result.reason = result.reasonBuf;
+    return true;
+}
+
+// Check service UUIDs
+template <typename Adv>
+bool checkServiceUUIDs(const Adv& adv, DetectionResult& result) {
+    for (int i = 0; GLASSES_SERVICE_UUIDS[i].uuid16 != 0; i++) {
+        if (adv.advertisesService16(GLASSES_SERVICE_UUIDS[i].uuid16)) {
+            result.detected = true;
+            result.company = GLASSES_SERVICE_UUIDS[i].owner;
+            result.product = GLASSES_SERVICE_UUIDS[i].description;
+            result.hasCamera = true;
+            result.tier = TIER_HIGH;
+            result.reasons |= REASON_SERVICE_UUID;
+            snprintf(result.reasonBuf, sizeof(result.reasonBuf),
+                     "Service UUID 0x%04X (%s)",
+                     GLASSES_SERVICE_UUIDS[i].uuid16,
+                     GLASSES_SERVICE_UUIDS[i].owner);
+            result.reason = result.reasonBuf;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check device name patterns
+inline bool checkDeviceName(const char* name, size_t len, DetectionResult& result) {
+    const GlassesNamePattern* match = NameTable::find(name, len);
+    if (!match) return false;
+
+    result.detected = true;
+    result.company = match->product;
+    result.product = match->product;
+    result.hasCamera = match->hasCamera;
+    result.tier = TIER_HIGH;  // Name match is high confidence
+    result.reasons |= REASON_DEVICE_NAME;
+    snprintf(result.reasonBuf, sizeof(result.reasonBuf),
+             "Device name '%.*s' matches '%s'",
+             (int)len, name, match->pattern);
+    result.reason = result.reasonBuf;
+    return true;
+}
+
+// Check MAC OUI prefix (supplementary — BLE MACs can be random)
+inline bool checkOUIPrefix(const uint8_t* mac, DetectionResult& result) {
+    const OuiEntry* match = OuiTable::find(mac);
+    if (!match) return false;
+
+    result.detected = true;
+    result.company = match->vendor;
+    result.product = "Smart Glasses (OUI match)";
+    result.hasCamera = true;
+    result.tier = TIER_MEDIUM;  // OUI is supplementary
+    result.reasons |= REASON_OUI_PREFIX;
+    snprintf(result.reasonBuf, sizeof(result.reasonBuf),
+             "OUI prefix %02X:%02X:%02X (%s)",
+             mac[0], mac[1], mac[2], match->vendor);
+    result.reason = result.reasonBuf;
+    return true;
+}
+
+// ============================================================
+// Device Tracking (Cooldown Deduplication)
+// ============================================================
+
+struct TrackedDevice {
+    uint8_t  mac[6];
+    uint32_t lastSeen;
+    int      rssi;
+    uint8_t  tier;
+    bool     hasCamera;
+};
+
+struct DeviceTracker {
+    TrackedDevice devices[MAX_TRACKED_DEVICES];
+    int           count = 0;
+
+    // Check if a device was recently seen (within cooldown window)
+    bool isCoolingDown(const uint8_t* mac, uint32_t now) {
+        for (int i = 0; i < count; i++) {
+            if (memcmp(devices[i].mac, mac, 6) == 0) {
+                if (now - devices[i].lastSeen < DETECTION_COOLDOWN_MS) {
+                    return true;
+                }
+                // Cooldown expired, update timestamp
+                devices[i].lastSeen = now;
+                return false;
+            }
+        }
+        return false;
+    }
+
+    void track(const uint8_t* mac, int rssi, uint8_t tier, bool hasCamera, uint32_t now) {
+        // Update existing entry
+        for (int i = 0; i < count; i++) {
+            if (memcmp(devices[i].mac, mac, 6) == 0) {
+                devices[i].lastSeen = now;
+                devices[i].rssi = rssi;
+                return;
+            }
+        }
+
+        // Add new entry (evict oldest if full)
+        int slot = count;
+        if (count >= MAX_TRACKED_DEVICES) {
+            slot = 0;
+            for (int i = 1; i < count; i++) {
+                if (devices[i].lastSeen < devices[slot].lastSeen) slot = i;
+            }
+        } else {
+            count++;
+        }
+        memcpy(devices[slot].mac, mac, 6);
+        devices[slot].lastSeen = now;
+        devices[slot].rssi = rssi;
+        devices[slot].tier = tier;
+        devices[slot].hasCamera = hasCamera;
+    }
+};
+
+#endif // DETECTION_H
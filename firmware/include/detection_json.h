@@ -0,0 +1,61 @@
+/*
+ * ESP-GlassHole — Detection JSON
+ *
+ * Builds the "detection" serial message from an advertisement (see
+ * detection.h for the interface) or a captured Wi-Fi frame, so firmware
+ * and host tools emit byte-identical output.
+ */
+
+#ifndef DETECTION_JSON_H
+#define DETECTION_JSON_H
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+#include "detection.h"
+#include "wifi_sniffer.h"
+
+template <typename Adv>
+void buildDetectionJSON(JsonDocument& doc, const Adv& adv, const DetectionResult& result,
+                        uint32_t ts) {
+    const uint8_t* mac = adv.mac();
+    char macStr[18];
+    snprintf(macStr, sizeof(macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    doc["type"] = "detection";
+    doc["mac"] = macStr;
+    doc["company"] = result.company;
+    doc["product"] = result.product;
+    doc["reason"] = result.reason;
+    doc["rssi"] = adv.rssi();
+    doc["hasCamera"] = result.hasCamera;
+    doc["tier"] = result.tier;
+
+    const char* name;
+    size_t nameLen;
+    if (adv.name(name, nameLen)) {
+        doc["deviceName"] = JsonString(name, nameLen);
+    }
+
+    uint16_t cid;
+    if (adv.companyId(cid)) {
+        char cidHex[7];
+        snprintf(cidHex, sizeof(cidHex), "0x%04X", cid);
+        doc["companyId"] = cidHex;
+    }
+
+    doc["ts"] = ts;
+}
+
+// Wi-Fi detections: the same message, deviceName carrying the SSID, plus
+// where the frame was heard
+inline void buildWifiDetectionJSON(JsonDocument& doc, const WifiFrame& frame,
+                                   const DetectionResult& result, uint32_t ts) {
+    buildDetectionJSON(doc, frame, result, ts);
+    doc["source"] = "wifi";
+    doc["channel"] = frame.channel;
+    doc["frame"] = wifiFrameKindName(frame.kind);
+}
+
+#endif // DETECTION_JSON_H
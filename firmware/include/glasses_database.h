@@ -48,7 +48,7 @@ struct GlassesCompanyID {
     uint8_t     tier;
 };
 
-static const GlassesCompanyID GLASSES_COMPANY_IDS[] = {
+static constexpr GlassesCompanyID GLASSES_COMPANY_IDS[] = {
     // --- TIER HIGH: Dedicated smart glasses companies ---
     { 0x01AB, "Meta Platforms",              "Ray-Ban Meta",           true,  TIER_HIGH },
     { 0x058E, "Meta Platforms Technologies", "Ray-Ban Meta / Quest",   true,  TIER_HIGH },
@@ -86,7 +86,7 @@ static const GlassesCompanyID GLASSES_COMPANY_IDS[] = {
     { 0x0000, NULL, NULL, false, 0 }
 };
 
-static const int GLASSES_COMPANY_ID_COUNT =
+static constexpr int GLASSES_COMPANY_ID_COUNT =
     (sizeof(GLASSES_COMPANY_IDS) / sizeof(GLASSES_COMPANY_IDS[0])) - 1;
 
 // ============================================================
@@ -109,7 +109,8 @@ static const GlassesServiceUUID GLASSES_SERVICE_UUIDS[] = {
 // BLE OUI Prefixes (first 3 bytes of MAC address)
 // ============================================================
 // NOTE: BLE MAC addresses can be randomized, making OUI detection
-// unreliable for BLE. These work better for WiFi detection.
+// unreliable for BLE. These work better for WiFi detection (see
+// wifi_sniffer.h).
 // Included as a secondary heuristic — match adds confidence
 // but should not be the sole detection method.
 
@@ -118,7 +119,7 @@ struct GlassesOUI {
     const char* vendor;
 };
 
-static const GlassesOUI GLASSES_OUI_PREFIXES[] = {
+static constexpr GlassesOUI GLASSES_OUI_PREFIXES[] = {
     // Meta Platforms Technologies (from glass-detect + ouispy-detector)
     { { 0x7C, 0x2A, 0x9E }, "Meta Platforms Technologies" },
     { { 0xCC, 0x66, 0x0A }, "Meta Platforms Technologies" },
@@ -130,6 +131,9 @@ static const GlassesOUI GLASSES_OUI_PREFIXES[] = {
     { { 0x00, 0x00, 0x00 }, NULL }
 };
 
+static constexpr int GLASSES_OUI_PREFIX_COUNT =
+    (sizeof(GLASSES_OUI_PREFIXES) / sizeof(GLASSES_OUI_PREFIXES[0])) - 1;
+
 // ============================================================
 // BLE Device Name Patterns (case-insensitive substring match)
 // ============================================================
@@ -140,7 +144,7 @@ struct GlassesNamePattern {
     bool        hasCamera;
 };
 
-static const GlassesNamePattern GLASSES_NAME_PATTERNS[] = {
+static constexpr GlassesNamePattern GLASSES_NAME_PATTERNS[] = {
     { "rayban",      "Meta Ray-Ban",       true },
     { "ray-ban",     "Meta Ray-Ban",       true },
     { "ray ban",     "Meta Ray-Ban",       true },
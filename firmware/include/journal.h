@@ -0,0 +1,621 @@
+/*
+ * ESP-GlassHole — Detection Journal
+ *
+ * Append-only log of detections in a raw flash partition, so a sensor
+ * left running unattended keeps its history across reboots.
+ *
+ * Layout: the partition is a ring of 4 KiB erase sectors. Each sector holds
+ * a header (magic, sequence number), 254 fixed-size 16-byte records and a
+ * footer written when the sector fills. Sectors are filled strictly in
+ * ring order and the oldest one is erased only when the ring wraps, so
+ * every sector sees the same number of erase cycles.
+ *
+ * The footer summarises the sector (time range, company bitmap, tier
+ * bitmap). At mount only headers and footers are read; the summaries stay
+ * in RAM as the query index, so time-range and per-company queries skip
+ * whole sectors without touching flash.
+ *
+ * Detections are queued from the BLE callback into a lock-free ring and
+ * written by service() from loop() in batches that never cross a 256-byte
+ * program page: the header shares page 0 with the first 15 records, every
+ * later page takes 16, so a full batch costs one page program. The
+ * callback never waits on flash, and may queue before mount() has run.
+ *
+ * Queries run from the oldest record forward and can be resumed, so a
+ * caller can hand out a few records per loop() pass.
+ *
+ * Journal time counts powered-on seconds only. At mount it resumes one
+ * second after the newest record, so powered time after the last
+ * detection before a reset or power cut is not counted: quiet periods
+ * that end in a reboot are compressed out of the timeline. Uptime is
+ * carried across the 49.7-day millis() rollover, which needs service()
+ * to run at least every 24 days.
+ *
+ * The flash backend is duck-typed:
+ *
+ *   uint32_t size() const;                                  // bytes
+ *   bool     read(uint32_t offset, void* buf, size_t len);
+ *   bool     write(uint32_t offset, const void* buf, size_t len);  // 1 -> 0 only
+ *   bool     eraseSector(uint32_t offset);                  // to 0xFF
+ *
+ * The firmware wraps esp_partition; host tools use a simulated NOR flash.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "config.h"
+#include "detection.h"
+
+// ============================================================
+// On-Flash Format
+// ============================================================
+
+#define JOURNAL_SECTOR_SIZE        4096
+#define JOURNAL_MAGIC              0x4A484C47   // "GLHJ"
+#define JOURNAL_FORMAT_VERSION     1
+#define JOURNAL_RECORD_SIZE        16
+#define JOURNAL_RECORDS_PER_SECTOR ((JOURNAL_SECTOR_SIZE - 2 * JOURNAL_RECORD_SIZE) / JOURNAL_RECORD_SIZE)
+#define JOURNAL_FOOTER_OFFSET      (JOURNAL_SECTOR_SIZE - JOURNAL_RECORD_SIZE)
+#define JOURNAL_PAGE_SIZE          256          // NOR program page
+#define JOURNAL_MAX_SECTORS        256          // Index capacity (1 MiB partition)
+
+#define JOURNAL_ANY_COMPANY        -1           // query(): no company filter
+
+struct JournalRecord {
+    uint32_t time;           // Journal seconds (see DetectionJournal::now)
+    uint8_t  mac[6];
+    uint8_t  companyIndex;   // GLASSES_COMPANY_IDS index or COMPANY_INDEX_NONE
+    int8_t   rssi;
+    uint8_t  tier;
+    uint8_t  reasons;        // REASON_* bits
+    uint8_t  boot;           // Low 8 bits of the boot counter
+    uint8_t  crc;            // CRC-8 of the first 15 bytes
+};
+
+struct JournalSectorHeader {
+    uint32_t magic;
+    uint32_t seq;            // Increases by one per sector opened
+    uint16_t version;
+    uint8_t  recordSize;
+    uint8_t  reserved[4];
+    uint8_t  crc;
+};
+
+struct JournalSectorFooter {
+    uint32_t minTime;
+    uint32_t maxTime;
+    uint32_t companyMask;    // See journalCompanyBit()
+    uint16_t count;
+    uint8_t  tierMask;
+    uint8_t  crc;
+};
+
+static_assert(sizeof(JournalRecord) == JOURNAL_RECORD_SIZE, "journal record must be 16 bytes");
+static_assert(sizeof(JournalSectorHeader) == JOURNAL_RECORD_SIZE, "sector header must be 16 bytes");
+static_assert(sizeof(JournalSectorFooter) == JOURNAL_RECORD_SIZE, "sector footer must be 16 bytes");
+static_assert((JOURNAL_QUEUE_RECORDS & (JOURNAL_QUEUE_RECORDS - 1)) == 0,
+              "JOURNAL_QUEUE_RECORDS must be a power of two");
+static_assert(JOURNAL_BATCH_RECORDS <= JOURNAL_QUEUE_RECORDS,
+              "JOURNAL_BATCH_RECORDS must fit in the queue");
+static_assert(JOURNAL_BATCH_RECORDS * JOURNAL_RECORD_SIZE <= JOURNAL_PAGE_SIZE,
+              "a journal batch must fit in one flash page");
+
+// CRC-8 (poly 0x07), a nibble at a time. Detects torn writes after power
+// loss; queries check it on every record they return.
+static const uint8_t JOURNAL_CRC8_NIBBLE[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+};
+
+inline uint8_t journalCrc8(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *p++;
+        crc = (uint8_t)(crc << 4) ^ JOURNAL_CRC8_NIBBLE[crc >> 4];
+        crc = (uint8_t)(crc << 4) ^ JOURNAL_CRC8_NIBBLE[crc >> 4];
+    }
+    return crc;
+}
+
+// Erased flash reads as 0xFF
+inline bool journalIsErased(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+// Bit 31 marks matches without a company index; the rest fold the index.
+// A set bit means "may contain", never a false negative.
+inline uint32_t journalCompanyBit(uint8_t companyIndex) {
+    if (companyIndex == COMPANY_INDEX_NONE) return 1u << 31;
+    return 1u << (companyIndex % 31);
+}
+
+inline bool journalRecordValid(const JournalRecord& rec) {
+    return rec.crc == journalCrc8(&rec, sizeof(rec) - 1);
+}
+
+// Map a company ID to its GLASSES_COMPANY_IDS index for query filters.
+// Returns -1 if the ID is not in the tiers of TierMask.
+template <uint8_t TierMask = CONFIG_TIER_MASK>
+int journalCompanyIndex(uint16_t companyId) {
+    const CompanyEntry* entry = CompanyTable<TierMask>::find(companyId);
+    return entry ? entry->index : -1;
+}
+
+// Build a queued record. time holds millis() until flush() converts it
+// to journal time and fills in boot and crc.
+inline JournalRecord makeJournalRecord(const uint8_t* mac, int rssi,
+                                       const DetectionResult& result, uint32_t millisNow) {
+    JournalRecord rec;
+    rec.time = millisNow;
+    memcpy(rec.mac, mac, 6);
+    rec.companyIndex = result.companyIndex;
+    rec.rssi = (int8_t)(rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi));
+    rec.tier = result.tier;
+    rec.reasons = result.reasons;
+    rec.boot = 0;
+    rec.crc = 0;
+    return rec;
+}
+
+// ============================================================
+// Journal
+// ============================================================
+
+// Per-sector summary kept in RAM; doubles as the query index
+struct JournalSectorInfo {
+    uint32_t seq;            // 0 = sector unused
+    uint32_t minTime;
+    uint32_t maxTime;
+    uint32_t companyMask;
+    uint16_t count;          // Records written (valid or torn)
+    uint8_t  tierMask;
+    bool     sealed;
+};
+
+struct JournalQueryStats {
+    uint32_t sectorsScanned;
+    uint32_t sectorsSkipped;
+    uint32_t recordsRead;
+    uint32_t recordsMatched;
+};
+
+// An incremental query: DetectionJournal::startQuery(), then resume()
+// until it returns false
+struct JournalCursor {
+    uint32_t          from;
+    uint32_t          to;
+    int               companyIndex;
+    uint32_t          sector;        // Sector being read
+    uint32_t          seq;           // Its sequence number when entered
+    uint32_t          record;        // Next record to read in it
+    bool              done;
+    JournalQueryStats stats;
+};
+
+struct JournalStats {
+    uint32_t sectors;        // Partition size in sectors
+    uint32_t sectorsUsed;
+    uint32_t records;        // Records on flash
+    uint32_t pending;        // Queued, not yet written
+    uint32_t dropped;        // Queue full (since boot)
+    uint32_t flushes;        // Batched writes (since boot)
+    uint32_t erases;         // Sector erases (since boot)
+    uint32_t writeErrors;
+    uint32_t oldestTime;
+    uint32_t newestTime;
+};
+
+template <typename Flash>
+class DetectionJournal {
+public:
+    explicit DetectionJournal(Flash& flash) : flash_(flash) {}
+
+    // Scan sector headers/footers and rebuild the index. Returns false if
+    // the partition is too small to hold a ring.
+    bool mount() {
+        mounted_ = false;
+        sectorCount_ = flash_.size() / JOURNAL_SECTOR_SIZE;
+        if (sectorCount_ > JOURNAL_MAX_SECTORS) sectorCount_ = JOURNAL_MAX_SECTORS;
+        if (sectorCount_ < 2) return false;
+
+        head_ = -1;
+        uint32_t headSeq = 0;
+        for (uint32_t s = 0; s < sectorCount_; s++) {
+            loadSector(s);
+            if (index_[s].seq != 0 && (head_ < 0 || index_[s].seq > headSeq)) {
+                head_ = (int)s;
+                headSeq = index_[s].seq;
+            }
+        }
+
+        timeBase_ = 0;
+        boot_ = 0;
+        if (head_ >= 0) {
+            nextSeq_ = headSeq + 1;
+            // Resume journal time and boot counter after the newest record.
+            // Powered time after it is lost (see the top of this file).
+            JournalRecord last;
+            if (lastValidRecord(last)) {
+                timeBase_ = last.time + 1;
+                boot_ = (uint8_t)(last.boot + 1);
+            }
+        } else {
+            nextSeq_ = 1;
+        }
+        mounted_ = true;
+        return true;
+    }
+
+    bool mounted() const { return mounted_; }
+
+    // Seconds since the journal was created, counting powered time only
+    // up to the newest record of each boot. There is no RTC; the host maps
+    // this to wall time when it dumps.
+    uint32_t now(uint32_t millisNow) const {
+        return timeBase_ + (uint32_t)(uptimeMs(millisNow) / 1000);
+    }
+    uint8_t  boot() const { return boot_; }
+
+    // Queue a record from makeJournalRecord(). Safe to call from one producer task (the BLE
+    // callback) concurrently with service() on another.
+    bool append(const JournalRecord& rec) {
+        uint32_t head = qHead_.load(std::memory_order_relaxed);
+        uint32_t tail = qTail_.load(std::memory_order_acquire);
+        if (head - tail >= JOURNAL_QUEUE_RECORDS) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_[head % JOURNAL_QUEUE_RECORDS] = rec;
+        qHead_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t pending() const {
+        return qHead_.load(std::memory_order_acquire) - qTail_.load(std::memory_order_relaxed);
+    }
+
+    // Call from loop(). Writes a batch once enough records are queued to
+    // fill the current flash page, or the oldest has waited JOURNAL_FLUSH_MS.
+    void service(uint32_t millisNow) {
+        lastUptimeMs_ = uptimeMs(millisNow);
+        uint32_t n = pending();
+        if (n == 0) {
+            lastFlushMs_ = millisNow;
+            return;
+        }
+        if (n >= nextBatchRecords() || millisNow - lastFlushMs_ >= JOURNAL_FLUSH_MS) {
+            flush();
+            lastFlushMs_ = millisNow;
+        }
+    }
+
+    // Write everything queued, one program operation per flash page.
+    void flush() {
+        if (!mounted_) return;
+        uint32_t tail = qTail_.load(std::memory_order_relaxed);
+        uint32_t head = qHead_.load(std::memory_order_acquire);
+        if (tail == head) return;
+        flushes_++;
+
+        JournalRecord batch[JOURNAL_BATCH_RECORDS];
+        while (tail != head) {
+            if (head_ < 0 || index_[head_].count >= JOURNAL_RECORDS_PER_SECTOR) {
+                if (!openNextSector()) break;
+            }
+            JournalSectorInfo& info = index_[head_];
+            uint32_t room = JOURNAL_RECORDS_PER_SECTOR - info.count;
+            uint32_t n = head - tail;
+            if (n > room) n = room;
+            uint32_t page = pageRecordsLeft(info.count);
+            if (n > page) n = page;
+
+            for (uint32_t i = 0; i < n; i++) {
+                JournalRecord& rec = batch[i];
+                rec = queue_[(tail + i) % JOURNAL_QUEUE_RECORDS];
+                rec.time = timeBase_ + (uint32_t)(uptimeMs(rec.time) / 1000);
+                rec.boot = boot_;
+                rec.crc = journalCrc8(&rec, sizeof(rec) - 1);
+                noteRecord(info, rec);
+            }
+            uint32_t offset = recordOffset(head_, info.count);
+            if (!flash_.write(offset, batch, n * sizeof(JournalRecord))) writeErrors_++;
+            info.count += n;
+            tail += n;
+            qTail_.store(tail, std::memory_order_release);
+
+            if (info.count >= JOURNAL_RECORDS_PER_SECTOR) sealSector(head_);
+        }
+    }
+
+    // Visit records with from <= time <= to, oldest first. companyIndex
+    // filters on GLASSES_COMPANY_IDS index (COMPANY_INDEX_NONE selects
+    // matches from UUID/name/OUI). The visitor returns false to stop.
+    template <typename Visitor>
+    JournalQueryStats query(uint32_t from, uint32_t to, int companyIndex, Visitor visit) {
+        JournalCursor c = startQuery(from, to, companyIndex);
+        resume(c, UINT32_MAX, visit);
+        return c.stats;
+    }
+
+    // The same query in steps: each resume() visits at most maxMatches
+    // records and returns true while more may follow. Records written in
+    // between are included; if a wrap reclaims the sector the cursor is
+    // in, it carries on from the oldest sector left.
+    JournalCursor startQuery(uint32_t from, uint32_t to, int companyIndex) {
+        JournalCursor c = {};
+        c.from = from;
+        c.to = to;
+        c.companyIndex = companyIndex;
+        if (mounted_) flush();
+        c.done = !mounted_ || head_ < 0;
+        if (!c.done) enterSector(c, oldestSector());
+        return c;
+    }
+
+    template <typename Visitor>
+    bool resume(JournalCursor& c, uint32_t maxMatches, Visitor visit) {
+        if (c.done) return false;
+        flush();
+
+        uint32_t mask = c.companyIndex == JOURNAL_ANY_COMPANY
+                            ? 0xFFFFFFFFu
+                            : journalCompanyBit((uint8_t)c.companyIndex);
+        uint32_t visited = 0;
+
+        while (true) {
+            const JournalSectorInfo& info = index_[c.sector];
+            if (info.seq != c.seq) {
+                enterSector(c, oldestSector());
+                continue;
+            }
+
+            if (c.record == 0 && info.count > 0) {
+                if (info.maxTime < c.from || info.minTime > c.to || !(info.companyMask & mask)) {
+                    c.stats.sectorsSkipped++;
+                    c.record = info.count;
+                } else {
+                    c.stats.sectorsScanned++;
+                }
+            }
+
+            JournalRecord chunk[JOURNAL_BATCH_RECORDS];
+            while (c.record < info.count) {
+                uint32_t n = info.count - c.record;
+                if (n > JOURNAL_BATCH_RECORDS) n = JOURNAL_BATCH_RECORDS;
+                if (!flash_.read(recordOffset(c.sector, c.record), chunk, n * sizeof(JournalRecord))) {
+                    c.record = info.count;
+                    break;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    const JournalRecord& rec = chunk[i];
+                    c.record++;
+                    c.stats.recordsRead++;
+                    if (rec.time < c.from || rec.time > c.to) continue;
+                    if (c.companyIndex != JOURNAL_ANY_COMPANY && rec.companyIndex != c.companyIndex) continue;
+                    if (!journalRecordValid(rec)) continue;
+                    c.stats.recordsMatched++;
+                    if (!visit(rec)) {
+                        c.done = true;
+                        return false;
+                    }
+                    if (++visited >= maxMatches) return true;
+                }
+            }
+
+            // The sector being filled is the newest
+            if ((int)c.sector == head_) {
+                c.done = true;
+                return false;
+            }
+            enterSector(c, (c.sector + 1) % sectorCount_);
+        }
+    }
+
+    JournalStats stats() const {
+        JournalStats st = {};
+        st.sectors = sectorCount_;
+        st.pending = pending();
+        st.dropped = dropped_.load(std::memory_order_relaxed);
+        st.flushes = flushes_;
+        st.erases = erases_;
+        st.writeErrors = writeErrors_;
+        bool first = true;
+        for (uint32_t s = 0; s < sectorCount_; s++) {
+            const JournalSectorInfo& info = index_[s];
+            if (info.seq == 0) continue;
+            st.sectorsUsed++;
+            st.records += info.count;
+            if (info.companyMask == 0) continue;   // Only torn records
+            if (first || info.minTime < st.oldestTime) st.oldestTime = info.minTime;
+            if (first || info.maxTime > st.newestTime) st.newestTime = info.maxTime;
+            first = false;
+        }
+        return st;
+    }
+
+    const JournalSectorInfo& sectorInfo(uint32_t s) const { return index_[s]; }
+    uint32_t sectorCount() const { return sectorCount_; }
+
+private:
+    static uint32_t sectorOffset(uint32_t s) { return s * JOURNAL_SECTOR_SIZE; }
+    static uint32_t recordOffset(uint32_t s, uint32_t r) {
+        return sectorOffset(s) + JOURNAL_RECORD_SIZE * (1 + r);
+    }
+
+    // Records that fit before the flash page holding record r ends
+    static uint32_t pageRecordsLeft(uint32_t r) {
+        uint32_t used = (JOURNAL_RECORD_SIZE * (1 + r)) % JOURNAL_PAGE_SIZE;
+        uint32_t n = (JOURNAL_PAGE_SIZE - used) / JOURNAL_RECORD_SIZE;
+        return n < JOURNAL_BATCH_RECORDS ? n : JOURNAL_BATCH_RECORDS;
+    }
+
+    // millis() extended past its rollover: taken relative to the value
+    // service() last saw, so any reading within 24 days of it is placed
+    // correctly, including records queued just before a wrap.
+    uint64_t uptimeMs(uint32_t millisNow) const {
+        return lastUptimeMs_ + (int32_t)(millisNow - (uint32_t)lastUptimeMs_);
+    }
+
+    // Records service() waits for before writing: the rest of the page
+    uint32_t nextBatchRecords() const {
+        if (head_ < 0 || index_[head_].count >= JOURNAL_RECORDS_PER_SECTOR) return pageRecordsLeft(0);
+        uint32_t n = pageRecordsLeft(index_[head_].count);
+        uint32_t room = JOURNAL_RECORDS_PER_SECTOR - index_[head_].count;
+        return n < room ? n : room;
+    }
+
+    // Oldest sector in use: the first after the head in ring order
+    uint32_t oldestSector() const {
+        for (uint32_t k = 1; k < sectorCount_; k++) {
+            uint32_t s = (head_ + k) % sectorCount_;
+            if (index_[s].seq != 0) return s;
+        }
+        return head_;
+    }
+
+    void enterSector(JournalCursor& c, uint32_t s) const {
+        c.sector = s;
+        c.seq = index_[s].seq;
+        c.record = 0;
+    }
+
+    // Every noted record sets a company bit, so an empty mask means no
+    // time range yet
+    static void noteRecord(JournalSectorInfo& info, const JournalRecord& rec) {
+        bool first = info.companyMask == 0;
+        if (first || rec.time < info.minTime) info.minTime = rec.time;
+        if (first || rec.time > info.maxTime) info.maxTime = rec.time;
+        info.companyMask |= journalCompanyBit(rec.companyIndex);
+        info.tierMask |= (uint8_t)(1u << (rec.tier & 7));
+    }
+
+    void loadSector(uint32_t s) {
+        JournalSectorInfo& info = index_[s];
+        memset(&info, 0, sizeof(info));
+
+        JournalSectorHeader hdr;
+        if (!flash_.read(sectorOffset(s), &hdr, sizeof(hdr))) return;
+        if (hdr.magic != JOURNAL_MAGIC || hdr.version != JOURNAL_FORMAT_VERSION ||
+            hdr.recordSize != JOURNAL_RECORD_SIZE ||
+            hdr.crc != journalCrc8(&hdr, sizeof(hdr) - 1)) {
+            return;   // Erased, foreign or torn header: treat as free
+        }
+        info.seq = hdr.seq;
+
+        JournalSectorFooter ftr;
+        if (flash_.read(sectorOffset(s) + JOURNAL_FOOTER_OFFSET, &ftr, sizeof(ftr)) &&
+            ftr.crc == journalCrc8(&ftr, sizeof(ftr) - 1)) {
+            info.minTime = ftr.minTime;
+            info.maxTime = ftr.maxTime;
+            info.companyMask = ftr.companyMask;
+            info.count = ftr.count;
+            info.tierMask = ftr.tierMask;
+            info.sealed = true;
+            return;
+        }
+
+        // Open (or sealed without a footer after power loss): rebuild the
+        // summary from the records, stopping at the first erased slot
+        JournalRecord chunk[JOURNAL_BATCH_RECORDS];
+        for (uint32_t r = 0; r < JOURNAL_RECORDS_PER_SECTOR; r += JOURNAL_BATCH_RECORDS) {
+            uint32_t n = JOURNAL_RECORDS_PER_SECTOR - r;
+            if (n > JOURNAL_BATCH_RECORDS) n = JOURNAL_BATCH_RECORDS;
+            if (!flash_.read(recordOffset(s, r), chunk, n * sizeof(JournalRecord))) return;
+            for (uint32_t i = 0; i < n; i++) {
+                if (journalIsErased(&chunk[i], sizeof(JournalRecord))) return;
+                // Torn records still occupy their slot but stay out of the summary
+                if (journalRecordValid(chunk[i])) noteRecord(info, chunk[i]);
+                info.count++;
+            }
+        }
+    }
+
+    bool lastValidRecord(JournalRecord& out) {
+        // Newest sector may hold only torn records; walk back one sector
+        for (uint32_t k = 0; k < 2; k++) {
+            uint32_t s = (head_ + sectorCount_ - k) % sectorCount_;
+            const JournalSectorInfo& info = index_[s];
+            if (info.seq == 0) return false;
+            for (int r = (int)info.count - 1; r >= 0; r--) {
+                if (flash_.read(recordOffset(s, r), &out, sizeof(out)) && journalRecordValid(out)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void sealSector(uint32_t s) {
+        JournalSectorInfo& info = index_[s];
+        JournalSectorFooter ftr;
+        ftr.minTime = info.minTime;
+        ftr.maxTime = info.maxTime;
+        ftr.companyMask = info.companyMask;
+        ftr.count = info.count;
+        ftr.tierMask = info.tierMask;
+        ftr.crc = journalCrc8(&ftr, sizeof(ftr) - 1);
+        if (!flash_.write(sectorOffset(s) + JOURNAL_FOOTER_OFFSET, &ftr, sizeof(ftr))) writeErrors_++;
+        info.sealed = true;
+    }
+
+    bool openNextSector() {
+        uint32_t s = head_ < 0 ? 0 : (head_ + 1) % sectorCount_;
+        if (!flash_.eraseSector(sectorOffset(s))) {
+            writeErrors_++;
+            return false;
+        }
+        erases_++;
+
+        JournalSectorHeader hdr;
+        memset(&hdr, 0xFF, sizeof(hdr));
+        hdr.magic = JOURNAL_MAGIC;
+        hdr.seq = nextSeq_++;
+        hdr.version = JOURNAL_FORMAT_VERSION;
+        hdr.recordSize = JOURNAL_RECORD_SIZE;
+        hdr.crc = journalCrc8(&hdr, sizeof(hdr) - 1);
+        if (!flash_.write(sectorOffset(s), &hdr, sizeof(hdr))) {
+            writeErrors_++;
+            return false;
+        }
+
+        JournalSectorInfo& info = index_[s];
+        memset(&info, 0, sizeof(info));
+        info.seq = hdr.seq;
+        head_ = (int)s;
+        return true;
+    }
+
+    Flash&            flash_;
+    JournalSectorInfo index_[JOURNAL_MAX_SECTORS] = {};
+    uint32_t          sectorCount_ = 0;
+    int               head_ = -1;      // Sector currently being filled
+    uint32_t          nextSeq_ = 1;
+    uint32_t          timeBase_ = 0;
+    uint64_t          lastUptimeMs_ = 0;   // Extended millis() at the last service()
+    uint8_t           boot_ = 0;
+    bool              mounted_ = false;
+
+    // Single-producer/single-consumer queue (BLE task -> loop)
+    JournalRecord         queue_[JOURNAL_QUEUE_RECORDS];
+    std::atomic<uint32_t> qHead_{0};
+    std::atomic<uint32_t> qTail_{0};
+    std::atomic<uint32_t> dropped_{0};
+
+    uint32_t lastFlushMs_ = 0;
+    uint32_t flushes_ = 0;
+    uint32_t erases_ = 0;
+    uint32_t writeErrors_ = 0;
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,40 @@
+/*
+ * ESP-GlassHole — Journal JSON
+ *
+ * Serial form of a journal record, shared by the firmware's query command
+ * and the host dump tool so both print the same lines.
+ */
+
+#ifndef JOURNAL_JSON_H
+#define JOURNAL_JSON_H
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+#include "journal.h"
+
+// TierMask selects the company table used to name records: the firmware's
+// own tiers on the device, all tiers in host tools.
+template <uint8_t TierMask = CONFIG_TIER_MASK>
+void buildJournalJSON(JsonDocument& doc, const JournalRecord& rec) {
+    char macStr[18];
+    snprintf(macStr, sizeof(macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
+             rec.mac[0], rec.mac[1], rec.mac[2], rec.mac[3], rec.mac[4], rec.mac[5]);
+
+    doc["type"] = "journal";
+    doc["time"] = rec.time;
+    doc["boot"] = rec.boot;
+    doc["mac"] = macStr;
+    const CompanyEntry* entry = CompanyTable<TierMask>::byIndex(rec.companyIndex);
+    if (entry) {
+        char cidHex[7];
+        snprintf(cidHex, sizeof(cidHex), "0x%04X", entry->info.id);
+        doc["companyId"] = cidHex;
+        doc["company"] = entry->info.company;
+    }
+    doc["rssi"] = rec.rssi;
+    doc["tier"] = rec.tier;
+    doc["reasons"] = rec.reasons;
+}
+
+#endif // JOURNAL_JSON_H
@@ -0,0 +1,229 @@
+/*
+ * ESP-GlassHole — Detection Pipeline
+ *
+ * The per-advertisement pipeline as a compile-time composition of stages:
+ *
+ *   gate -> matchers (priority order, first hit wins) -> tracker -> sinks
+ *
+ * Each stage is a type with static members; DetectionPipeline strings
+ * them together and everything inlines into one function per advert
+ * type. Stages switched off in config.h (or per board in platformio.ini)
+ * are replaced by empty types and leave no code behind, and the company
+ * ID table is already reduced to the enabled tiers (detection.h).
+ *
+ * GlassholePipeline is the composition the firmware runs. Host tools
+ * instantiate the same type with their own advert and sink types. The
+ * Wi-Fi sniffer composes its own pipeline over the same tracker
+ * (wifi_sniffer.h).
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "config.h"
+#include "detection.h"
+
+// ============================================================
+// Gate
+// ============================================================
+
+// Drops adverts weaker than MinRssi before any matcher runs
+template <int MinRssi>
+struct RssiGate {
+    template <typename Adv>
+    static bool pass(const Adv& adv) { return adv.rssi() >= MinRssi; }
+};
+
+// ============================================================
+// Matchers
+// ============================================================
+// match() fills result and returns true on a hit.
+
+template <uint8_t TierMask>
+struct CompanyIdMatcher {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        uint16_t companyId;
+        return adv.companyId(companyId) && checkCompanyID<TierMask>(companyId, result);
+    }
+};
+
+struct ServiceUuidMatcher {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        return checkServiceUUIDs(adv, result);
+    }
+};
+
+struct DeviceNameMatcher {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        const char* name;
+        size_t nameLen;
+        return adv.name(name, nameLen) && checkDeviceName(name, nameLen, result);
+    }
+};
+
+struct OuiMatcher {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        return checkOUIPrefix(adv.mac(), result);
+    }
+};
+
+// Stands in for a disabled matcher
+struct NoMatcher {
+    template <typename Adv>
+    static constexpr bool match(const Adv&, DetectionResult&) { return false; }
+};
+
+template <bool Enabled, typename Matcher>
+using OptionalMatcher = typename std::conditional<Enabled, Matcher, NoMatcher>::type;
+
+// Runs matchers in order and stops at the first hit
+template <typename... Matchers>
+struct MatcherChain {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        return (Matchers::match(adv, result) || ...);
+    }
+};
+
+// Adds Reason bits to any hit of Matcher, e.g. to mark the source
+template <uint8_t Reason, typename Matcher>
+struct TaggedMatcher {
+    template <typename Adv>
+    static bool match(const Adv& adv, DetectionResult& result) {
+        if (!Matcher::match(adv, result)) return false;
+        result.reasons |= Reason;
+        return true;
+    }
+};
+
+// ============================================================
+// Tracker
+// ============================================================
+// admit() decides whether a match raises an alert and updates State.
+
+// Per-device cooldown (DeviceTracker in detection.h)
+struct CooldownTracker {
+    typedef DeviceTracker State;
+
+    static bool admit(State& tracker, const uint8_t* mac, int rssi,
+                      const DetectionResult& result, uint32_t now) {
+        if (tracker.isCoolingDown(mac, now)) return false;
+        tracker.track(mac, rssi, result.tier, result.hasCamera, now);
+        return true;
+    }
+};
+
+// Every match alerts; no state
+struct NoTracker {
+    struct State {
+        static constexpr int count = 0;
+    };
+
+    static constexpr bool admit(State&, const uint8_t*, int, const DetectionResult&, uint32_t) {
+        return true;
+    }
+};
+
+// ============================================================
+// Sinks
+// ============================================================
+// A sink is any callable taking (const Adv&, const DetectionResult&).
+// SinkChain calls default-constructed sinks in order; a disabled sink is
+// NoSink.
+
+struct NoSink {
+    template <typename Adv>
+    void operator()(const Adv&, const DetectionResult&) const {}
+};
+
+template <typename... Sinks>
+struct SinkChain {
+    template <typename Adv>
+    void operator()(const Adv& adv, const DetectionResult& result) const {
+        (Sinks()(adv, result), ...);
+    }
+};
+
+// ============================================================
+// Pipeline
+// ============================================================
+
+template <typename Gate, typename Matchers, typename Tracker>
+struct DetectionPipeline {
+    typedef typename Tracker::State State;
+
+    // Matchers only, no gate or tracking
+    template <typename Adv>
+    static bool detect(const Adv& adv, DetectionResult& result) {
+        result.detected = false;
+        result.companyIndex = COMPANY_INDEX_NONE;
+        result.reasons = 0;
+        return Matchers::match(adv, result);
+    }
+
+    // Everything before side effects: gate, matchers, tracking. Returns
+    // true when the advert should raise an alert.
+    template <typename Adv>
+    static bool process(const Adv& adv, State& state, uint32_t now, DetectionResult& result) {
+        if (!Gate::pass(adv)) return false;
+        if (!detect(adv, result)) return false;
+        return Tracker::admit(state, adv.mac(), adv.rssi(), result, now);
+    }
+
+    // process() and hand alerts to the sink
+    template <typename Adv, typename Sink>
+    static bool run(const Adv& adv, State& state, uint32_t now, Sink&& sink) {
+        DetectionResult result;
+        if (!process(adv, state, now, result)) return false;
+        sink(adv, result);
+        return true;
+    }
+};
+
+// ============================================================
+// Configured Pipeline
+// ============================================================
+// Service UUID and name matches report TIER_HIGH, OUI matches
+// TIER_MEDIUM; a matcher is dropped along with its tier.
+
+constexpr bool PIPELINE_COMPANY_ID   = ENABLE_MATCH_COMPANY_ID && CONFIG_TIER_MASK != 0;
+constexpr bool PIPELINE_SERVICE_UUID = ENABLE_MATCH_SERVICE_UUID && tierEnabled(TIER_HIGH);
+constexpr bool PIPELINE_DEVICE_NAME  = ENABLE_MATCH_DEVICE_NAME && tierEnabled(TIER_HIGH);
+constexpr bool PIPELINE_OUI          = ENABLE_MATCH_OUI && tierEnabled(TIER_MEDIUM);
+
+typedef MatcherChain<
+    OptionalMatcher<PIPELINE_COMPANY_ID, CompanyIdMatcher<CONFIG_TIER_MASK>>,
+    OptionalMatcher<PIPELINE_SERVICE_UUID, ServiceUuidMatcher>,
+    OptionalMatcher<PIPELINE_DEVICE_NAME, DeviceNameMatcher>,
+    OptionalMatcher<PIPELINE_OUI, OuiMatcher>
+> GlassholeMatchers;
+
+typedef std::conditional<ENABLE_COOLDOWN, CooldownTracker, NoTracker>::type GlassholeTracker;
+
+typedef DetectionPipeline<
+    RssiGate<RSSI_THRESHOLD_DEFAULT>,
+    GlassholeMatchers,
+    GlassholeTracker
+> GlassholePipeline;
+
+// Entry points for callers that don't name the pipeline type
+template <typename Adv>
+bool detectGlasses(const Adv& adv, DetectionResult& result) {
+    return GlassholePipeline::detect(adv, result);
+}
+
+template <typename Adv>
+bool processAdvertisement(const Adv& adv, GlassholePipeline::State& state, uint32_t now,
+                          DetectionResult& result) {
+    return GlassholePipeline::process(adv, state, now, result);
+}
+
+#endif // PIPELINE_H
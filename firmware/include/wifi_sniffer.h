@@ -0,0 +1,272 @@
+/*
+ * ESP-GlassHole — Wi-Fi Frame Capture
+ *
+ * Portable half of the Wi-Fi sniffer. The promiscuous-mode callback runs
+ * on the Wi-Fi task for every received frame, so it only does a bounded
+ * header parse (no allocation, no locks, at most 32 bytes of SSID copied)
+ * and a cheap pre-filter, then hands candidates to loop() through a
+ * lock-free single-producer/single-consumer ring:
+ *
+ *   callback:  parse80211 -> RSSI gate -> OUI bitmap / SSID pattern -> queue
+ *   loop():    queue -> WifiPipeline (OUI, SSID name) -> shared tracker, sinks
+ *
+ * WifiFrame implements the advertisement interface from detection.h, so
+ * the Wi-Fi pipeline reuses the BLE matchers, tracker and JSON builder.
+ * Host tools replay pcap captures through the same code.
+ */
+
+#ifndef WIFI_SNIFFER_H
+#define WIFI_SNIFFER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "config.h"
+#include "detection.h"
+#include "pipeline.h"
+
+static_assert((WIFI_QUEUE_FRAMES & (WIFI_QUEUE_FRAMES - 1)) == 0,
+              "WIFI_QUEUE_FRAMES must be a power of two");
+
+// ============================================================
+// 802.11 Header
+// ============================================================
+
+#define WIFI_HEADER_LEN          24     // Management / non-QoS data header
+#define WIFI_SSID_MAX            32
+
+#define WIFI_TYPE_MGMT           0
+#define WIFI_TYPE_DATA           2
+
+#define WIFI_SUBTYPE_ASSOC_REQ   0
+#define WIFI_SUBTYPE_REASSOC_REQ 2
+#define WIFI_SUBTYPE_PROBE_REQ   4
+#define WIFI_SUBTYPE_PROBE_RESP  5
+#define WIFI_SUBTYPE_BEACON      8
+
+#define WIFI_IE_SSID             0
+
+enum WifiFrameKind : uint8_t {
+    WIFI_FRAME_DATA = 0,
+    WIFI_FRAME_PROBE_REQ,
+    WIFI_FRAME_PROBE_RESP,
+    WIFI_FRAME_BEACON,
+    WIFI_FRAME_ASSOC_REQ,
+    WIFI_FRAME_MGMT,        // Any other management subtype
+};
+
+inline const char* wifiFrameKindName(uint8_t kind) {
+    switch (kind) {
+    case WIFI_FRAME_DATA:       return "data";
+    case WIFI_FRAME_PROBE_REQ:  return "probe_req";
+    case WIFI_FRAME_PROBE_RESP: return "probe_resp";
+    case WIFI_FRAME_BEACON:     return "beacon";
+    case WIFI_FRAME_ASSOC_REQ:  return "assoc_req";
+    default:                    return "mgmt";
+    }
+}
+
+// One captured frame, reduced to what the matchers need (44 bytes)
+struct WifiFrame {
+    uint8_t addr[6];            // Transmitter (addr2)
+    int8_t  signal;             // dBm
+    uint8_t channel;
+    uint8_t kind;               // WifiFrameKind
+    uint8_t ssidLen;            // 0: no SSID element, or hidden/wildcard
+    char    ssid[WIFI_SSID_MAX];  // Not NUL-terminated; unprintables as '?'
+
+    // --- Advertisement interface (detection.h) ---
+
+    int            rssi() const { return signal; }
+    const uint8_t* mac() const { return addr; }
+    bool           companyId(uint16_t&) const { return false; }
+    bool           advertisesService16(uint16_t) const { return false; }
+
+    bool name(const char*& str, size_t& len) const {
+        if (ssidLen == 0) return false;
+        str = ssid;
+        len = ssidLen;
+        return true;
+    }
+};
+
+static_assert(std::is_trivially_copyable<WifiFrame>::value, "WifiFrame is copied through the queue");
+
+// Offset of the tagged parameters in management frames that carry an
+// SSID element, or 0 for subtypes that don't
+inline size_t wifiIEOffset(uint8_t subtype) {
+    switch (subtype) {
+    case WIFI_SUBTYPE_PROBE_REQ:   return WIFI_HEADER_LEN;
+    case WIFI_SUBTYPE_ASSOC_REQ:   return WIFI_HEADER_LEN + 4;    // capability, listen interval
+    case WIFI_SUBTYPE_REASSOC_REQ: return WIFI_HEADER_LEN + 10;   // + current AP
+    case WIFI_SUBTYPE_PROBE_RESP:
+    case WIFI_SUBTYPE_BEACON:      return WIFI_HEADER_LEN + 12;   // timestamp, interval, capability
+    default:                       return 0;
+    }
+}
+
+// Parse a raw 802.11 frame (no radiotap, FCS optional). Control frames,
+// extension frames and anything shorter than a full header are rejected.
+// The SSID element is read only where the standard puts it first.
+inline bool parse80211(const uint8_t* buf, size_t len, int rssi, uint8_t channel,
+                       WifiFrame& out) {
+    if (len < WIFI_HEADER_LEN) return false;
+
+    uint8_t fc = buf[0];
+    if ((fc & 0x03) != 0) return false;   // Protocol version
+    uint8_t type = (fc >> 2) & 0x03;
+    uint8_t subtype = fc >> 4;
+    if (type != WIFI_TYPE_MGMT && type != WIFI_TYPE_DATA) return false;
+
+    memcpy(out.addr, buf + 10, 6);
+    out.signal = (int8_t)(rssi < -128 ? -128 : rssi > 127 ? 127 : rssi);
+    out.channel = channel;
+    out.ssidLen = 0;
+
+    if (type == WIFI_TYPE_DATA) {
+        out.kind = WIFI_FRAME_DATA;
+        return true;
+    }
+
+    switch (subtype) {
+    case WIFI_SUBTYPE_PROBE_REQ:   out.kind = WIFI_FRAME_PROBE_REQ; break;
+    case WIFI_SUBTYPE_PROBE_RESP:  out.kind = WIFI_FRAME_PROBE_RESP; break;
+    case WIFI_SUBTYPE_BEACON:      out.kind = WIFI_FRAME_BEACON; break;
+    case WIFI_SUBTYPE_ASSOC_REQ:
+    case WIFI_SUBTYPE_REASSOC_REQ: out.kind = WIFI_FRAME_ASSOC_REQ; break;
+    default:                       out.kind = WIFI_FRAME_MGMT; break;
+    }
+
+    size_t ie = wifiIEOffset(subtype);
+    if (ie == 0 || ie + 2 > len || buf[ie] != WIFI_IE_SSID) return true;
+    size_t ssidLen = buf[ie + 1];
+    if (ssidLen > WIFI_SSID_MAX || ie + 2 + ssidLen > len) return true;
+
+    const uint8_t* ssid = buf + ie + 2;
+    bool hidden = true;   // Hidden networks send zero-filled SSIDs
+    for (size_t i = 0; i < ssidLen; i++) {
+        uint8_t c = ssid[i];
+        if (c != 0) hidden = false;
+        out.ssid[i] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+    }
+    if (!hidden) out.ssidLen = (uint8_t)ssidLen;
+    return true;
+}
+
+// ============================================================
+// Configured Pipeline
+// ============================================================
+// OUI first: on Wi-Fi, universally administered addresses are the norm
+// for infrastructure and Wi-Fi Direct links. SSID names go through the
+// BLE name patterns. Matches carry REASON_WIFI. Same tracker as the BLE
+// pipeline, so one device seen on both radios alerts once per cooldown.
+
+constexpr bool PIPELINE_WIFI_OUI  = PIPELINE_OUI;
+constexpr bool PIPELINE_WIFI_SSID = ENABLE_WIFI_SSID_MATCH && PIPELINE_DEVICE_NAME;
+
+typedef TaggedMatcher<REASON_WIFI, MatcherChain<
+    OptionalMatcher<PIPELINE_WIFI_OUI, OuiMatcher>,
+    OptionalMatcher<PIPELINE_WIFI_SSID, DeviceNameMatcher>
+>> WifiMatchers;
+
+typedef DetectionPipeline<
+    RssiGate<WIFI_RSSI_THRESHOLD>,
+    WifiMatchers,
+    GlassholeTracker
+> WifiPipeline;
+
+static_assert(std::is_same<WifiPipeline::State, GlassholePipeline::State>::value,
+              "Wi-Fi and BLE pipelines share the tracker");
+
+// Callback-side pre-filter after the RSSI gate: could the pipeline match
+// this frame? The OUI test is the first-octet bitmap only; loop() does the
+// full lookup. SSIDs get the full name search, so the beacons and probe
+// responses of ordinary networks never reach the queue.
+inline bool wifiCandidate(const WifiFrame& frame) {
+    return (PIPELINE_WIFI_OUI && OuiTable::maybe(frame.addr)) ||
+           (PIPELINE_WIFI_SSID && NameTable::find(frame.ssid, frame.ssidLen));
+}
+
+// ============================================================
+// Capture Queue
+// ============================================================
+
+struct WifiCaptureStats {
+    uint32_t frames;       // Delivered to onFrame()
+    uint32_t parsed;       // Management and data frames
+    uint32_t weak;         // Parsed, below WIFI_RSSI_THRESHOLD
+    uint32_t rejected;     // Parsed, no listed OUI or SSID pattern
+    uint32_t candidates;   // Passed the pre-filter
+    uint32_t dropped;      // Candidates lost to a full queue
+    uint32_t pending;
+};
+
+class WifiCapture {
+public:
+    // Producer side: the promiscuous callback. Returns true if the frame
+    // was queued.
+    bool onFrame(const uint8_t* buf, size_t len, int rssi, uint8_t channel) {
+        frames_.fetch_add(1, std::memory_order_relaxed);
+
+        WifiFrame frame;
+        if (!parse80211(buf, len, rssi, channel, frame)) return false;
+        parsed_.fetch_add(1, std::memory_order_relaxed);
+        if (!RssiGate<WIFI_RSSI_THRESHOLD>::pass(frame)) {
+            weak_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!wifiCandidate(frame)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        candidates_.fetch_add(1, std::memory_order_relaxed);
+
+        uint32_t head = qHead_.load(std::memory_order_relaxed);
+        uint32_t tail = qTail_.load(std::memory_order_acquire);
+        if (head - tail >= WIFI_QUEUE_FRAMES) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_[head % WIFI_QUEUE_FRAMES] = frame;
+        qHead_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: loop()
+    bool pop(WifiFrame& out) {
+        uint32_t tail = qTail_.load(std::memory_order_relaxed);
+        if (tail == qHead_.load(std::memory_order_acquire)) return false;
+        out = queue_[tail % WIFI_QUEUE_FRAMES];
+        qTail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    WifiCaptureStats stats() const {
+        WifiCaptureStats st;
+        st.frames = frames_.load(std::memory_order_relaxed);
+        st.parsed = parsed_.load(std::memory_order_relaxed);
+        st.weak = weak_.load(std::memory_order_relaxed);
+        st.rejected = rejected_.load(std::memory_order_relaxed);
+        st.candidates = candidates_.load(std::memory_order_relaxed);
+        st.dropped = dropped_.load(std::memory_order_relaxed);
+        st.pending = qHead_.load(std::memory_order_acquire) - qTail_.load(std::memory_order_relaxed);
+        return st;
+    }
+
+private:
+    WifiFrame             queue_[WIFI_QUEUE_FRAMES];
+    std::atomic<uint32_t> qHead_{0};
+    std::atomic<uint32_t> qTail_{0};
+
+    std::atomic<uint32_t> frames_{0};
+    std::atomic<uint32_t> parsed_{0};
+    std::atomic<uint32_t> weak_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> candidates_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
+
+#endif // WIFI_SNIFFER_H
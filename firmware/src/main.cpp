@@ -11,6 +11,7 @@
  *   3. BLE device name pattern matching (tertiary)
  *   4. MAC OUI prefix matching (supplementary heuristic)
  *   5. Manufacturer data fingerprinting (specific product identification)
+ *   6. Wi-Fi promiscuous capture: transmitter OUI and SSID (optional)
  *
  * Based on research from:
  *   - yj_nearbyglasses (Yves Jeanrenaud)
@@ -28,9 +29,23 @@
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
 #include <ArduinoJson.h>
+#include <esp_system.h>
+#include <esp_partition.h>
 
 #include "config.h"
 #include "glasses_database.h"
+#include "detection.h"
+#include "detection_json.h"
+#include "pipeline.h"
+#include "wifi_sniffer.h"
+#include "journal.h"
+#include "journal_json.h"
+
+// Wi-Fi driver only when the sniffer is built in (config.h)
+#if ENABLE_WIFI_SNIFFER
+#include <WiFi.h>
+#include <esp_wifi.h>
+#endif
 
 // ============================================================
 // Board Detection & Pin Configuration
@@ -69,6 +84,17 @@
   #define LED_PIN 2
 #endif
 
+// PlatformIO env name, set per env in platformio.ini
+#ifndef BUILD_ENV
+  #define BUILD_ENV "unknown"
+#endif
+
+#define FIRMWARE_VERSION "2.0.0"
+
+// Data subtype of the "journal" entry in partitions_journal.csv
+#define JOURNAL_PARTITION_SUBTYPE 0x40
+#define COMMAND_BUFFER_SIZE       128
+
 // ============================================================
 // Global State
 // ============================================================
@@ -76,16 +102,7 @@
 BLEScan* pBLEScan = nullptr;
 
 // Tracked devices (for cooldown deduplication)
-struct TrackedDevice {
-    uint8_t  mac[6];
-    uint32_t lastSeen;
-    int      rssi;
-    uint8_t  tier;
-    bool     hasCamera;
-};
-
-TrackedDevice trackedDevices[MAX_TRACKED_DEVICES];
-int trackedDeviceCount = 0;
+GlassholePipeline::State tracker;
 
 // LED alert state
 volatile bool     alertActive = false;
@@ -101,6 +118,106 @@ uint32_t lastStatusTime = 0;
 uint32_t lastHeartbeatTime = 0;
 bool     scanInProgress = false;
 
+// Boot phase timestamps (micros() since app start; 0 = not reached yet).
+// The first-advert/detection stamps are written from the BLE task.
+struct BootTiming {
+    uint32_t          setupUs;
+    uint32_t          bleReadyUs;
+    uint32_t          scanStartUs;
+    volatile uint32_t firstAdvertUs;
+    volatile uint32_t firstDetectionUs;
+};
+
+BootTiming bootTiming = {};
+bool       bootReported = false;
+bool       bannerPending = false;
+uint32_t   bootFlashStart = 0;   // millis() when the async boot flash began
+bool       bootFlashActive = false;
+
+#if ENABLE_JOURNAL
+// ============================================================
+// Detection Journal
+// ============================================================
+
+// Flash backend for journal.h over the "journal" data partition
+class PartitionFlash {
+public:
+    bool begin() {
+        part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)JOURNAL_PARTITION_SUBTYPE,
+                                         "journal");
+        return part_ != nullptr;
+    }
+
+    uint32_t size() const { return part_ ? part_->size : 0; }
+
+    bool read(uint32_t offset, void* buf, size_t len) {
+        return esp_partition_read(part_, offset, buf, len) == ESP_OK;
+    }
+
+    bool write(uint32_t offset, const void* buf, size_t len) {
+        return esp_partition_write(part_, offset, buf, len) == ESP_OK;
+    }
+
+    bool eraseSector(uint32_t offset) {
+        return esp_partition_erase_range(part_, offset, JOURNAL_SECTOR_SIZE) == ESP_OK;
+    }
+
+private:
+    const esp_partition_t* part_ = nullptr;
+};
+
+PartitionFlash                   journalFlash;
+DetectionJournal<PartitionFlash> journal(journalFlash);
+#endif
+
+#if ENABLE_WIFI_SNIFFER
+// ============================================================
+// Wi-Fi Sniffer
+// ============================================================
+
+WifiCapture wifiCapture;               // Promiscuous callback -> loop()
+uint8_t     wifiChannel = 1;
+uint32_t    lastHopTime = 0;
+uint32_t    lastWifiFrames = 0;        // For frames/s in the status message
+uint32_t    lastWifiStatsTime = 0;
+
+// The BLE callback and loop() both run a pipeline over the shared tracker,
+// journal queue and serial port; this keeps them one at a time
+SemaphoreHandle_t pipelineMutex = nullptr;
+#endif
+
+#if MEASURE_PIPELINE_CYCLES
+// BLE pipeline cost per advert, updated under PipelineLock
+struct PipelineCycleStats {
+    uint32_t runs;
+    uint64_t total;
+    uint32_t max;
+};
+PipelineCycleStats pipelineCycles = {};
+#endif
+
+// Held around each pipeline run. A no-op while BLE is the only source.
+class PipelineLock {
+public:
+    PipelineLock() {
+#if ENABLE_WIFI_SNIFFER
+        xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+#endif
+    }
+
+    ~PipelineLock() {
+#if ENABLE_WIFI_SNIFFER
+        xSemaphoreGive(pipelineMutex);
+#endif
+    }
+};
+
+// Serial command input (one JSON object per line)
+char   commandBuf[COMMAND_BUFFER_SIZE];
+size_t commandLen = 0;
+bool   commandOverflow = false;
+
 // ============================================================
 // LED Control
 // ============================================================
@@ -138,6 +255,16 @@ uint32_t getBlinkRate(int rssi) {
 
 void updateLED() {
     if (!alertActive) {
+        // Boot flash — quick blinks to show we're alive
+        if (bootFlashActive) {
+            uint32_t elapsed = millis() - bootFlashStart;
+            if (elapsed < BOOT_FLASH_BLINKS * 200) {
+                if ((elapsed / 100) % 2 == 0) ledOn();
+                else ledOff();
+                return;
+            }
+            bootFlashActive = false;
+        }
         ledIdle();
         return;
     }
@@ -169,210 +296,72 @@ void triggerAlert(int rssi, uint8_t tier, bool hasCamera) {
 }
 
 // ============================================================
-// Device Tracking (Cooldown Deduplication)
-// ============================================================
-
-// Check if a device was recently seen (within cooldown window)
-bool isDeviceCoolingDown(const uint8_t* mac) {
-    uint32_t now = millis();
-    for (int i = 0; i < trackedDeviceCount; i++) {
-        if (memcmp(trackedDevices[i].mac, mac, 6) == 0) {
-            if (now - trackedDevices[i].lastSeen < DETECTION_COOLDOWN_MS) {
-                // Update RSSI for ongoing alert intensity
-                return true;
-            }
-            // Cooldown expired, update timestamp
-            trackedDevices[i].lastSeen = now;
-            return false;
-        }
-    }
-    return false;
-}
-
-void trackDevice(const uint8_t* mac, int rssi, uint8_t tier, bool hasCamera) {
-    uint32_t now = millis();
-
-    // Update existing entry
-    for (int i = 0; i < trackedDeviceCount; i++) {
-        if (memcmp(trackedDevices[i].mac, mac, 6) == 0) {
-            trackedDevices[i].lastSeen = now;
-            trackedDevices[i].rssi = rssi;
-            return;
-        }
-    }
-
-    // Add new entry (evict oldest if full)
-    if (trackedDeviceCount >= MAX_TRACKED_DEVICES) {
-        // Find oldest entry
-        int oldest = 0;
-        for (int i = 1; i < trackedDeviceCount; i++) {
-            if (trackedDevices[i].lastSeen < trackedDevices[oldest].lastSeen) {
-                oldest = i;
-            }
-        }
-        trackedDevices[oldest] = { {0}, now, rssi, tier, hasCamera };
-        memcpy(trackedDevices[oldest].mac, mac, 6);
-    } else {
-        memset(&trackedDevices[trackedDeviceCount], 0, sizeof(TrackedDevice));
-        memcpy(trackedDevices[trackedDeviceCount].mac, mac, 6);
-        trackedDevices[trackedDeviceCount].lastSeen = now;
-        trackedDevices[trackedDeviceCount].rssi = rssi;
-        trackedDevices[trackedDeviceCount].tier = tier;
-        trackedDevices[trackedDeviceCount].hasCamera = hasCamera;
-        trackedDeviceCount++;
-    }
-}
-
-// ============================================================
-// Detection Engine
+// BLE Advertisement Adapter
 // ============================================================
 
-// Convert raw bytes to uppercase hex string
-String bytesToHex(const uint8_t* data, size_t len) {
-    String hex = "";
-    for (size_t i = 0; i < len; i++) {
-        if (data[i] < 0x10) hex += "0";
-        hex += String(data[i], HEX);
+// Presents a BLEAdvertisedDevice through the interface in detection.h.
+// Manufacturer data and name are fetched on first use, since most adverts
+// are rejected by the RSSI gate before either is needed.
+class BLEAdvertView {
+public:
+    explicit BLEAdvertView(BLEAdvertisedDevice& device) : device_(device) {
+        memcpy(mac_, *device.getAddress().getNative(), 6);
     }
-    hex.toUpperCase();
-    return hex;
-}
 
-// Case-insensitive substring search
-bool containsIgnoreCase(const String& haystack, const char* needle) {
-    String lower = haystack;
-    lower.toLowerCase();
-    String needleLower = String(needle);
-    needleLower.toLowerCase();
-    return lower.indexOf(needleLower) >= 0;
-}
+    int rssi() const { return device_.getRSSI(); }
 
-struct DetectionResult {
-    bool        detected;
-    const char* company;
-    const char* product;
-    const char* reason;
-    bool        hasCamera;
-    uint8_t     tier;
-    char        reasonBuf[128];
-};
+    const uint8_t* mac() const { return mac_; }
 
-// Check company ID against database
-bool checkCompanyID(uint16_t companyId, DetectionResult& result) {
-    for (int i = 0; i < GLASSES_COMPANY_ID_COUNT; i++) {
-        const GlassesCompanyID& entry = GLASSES_COMPANY_IDS[i];
-        if (entry.id == companyId) {
-            // Check tier enablement
-            if (entry.tier == TIER_HIGH && !ENABLE_TIER_HIGH) continue;
-            if (entry.tier == TIER_MEDIUM && !ENABLE_TIER_MEDIUM) continue;
-            if (entry.tier == TIER_LOW && !ENABLE_TIER_LOW) continue;
-
-            result.detected = true;
-            result.company = entry.company;
-            result.product = entry.product;
-            result.hasCamera = entry.hasCamera;
-            result.tier = entry.tier;
-            snprintf(result.reasonBuf, sizeof(result.reasonBuf),
-                     "Company ID 0x%04X (%s)", companyId, entry.company);
-            result.reason = result.reasonBuf;
-            return true;
+    bool companyId(uint16_t& id) const {
+        if (!device_.haveManufacturerData()) return false;
+        if (!mfgFetched_) {
+            mfgData_ = device_.getManufacturerData();
+            mfgFetched_ = true;
         }
+        if (mfgData_.length() < 2) return false;
+        id = (uint8_t)mfgData_[0] | ((uint8_t)mfgData_[1] << 8);
+        return true;
     }
-    return false;
-}
 
-// Check service UUIDs
-bool checkServiceUUIDs(BLEAdvertisedDevice& device, DetectionResult& result) {
-    for (int i = 0; GLASSES_SERVICE_UUIDS[i].uuid16 != 0; i++) {
-        BLEUUID targetUUID(GLASSES_SERVICE_UUIDS[i].uuid16);
-        if (device.isAdvertisingService(targetUUID)) {
-            result.detected = true;
-            result.company = GLASSES_SERVICE_UUIDS[i].owner;
-            result.product = GLASSES_SERVICE_UUIDS[i].description;
-            result.hasCamera = true;
-            result.tier = TIER_HIGH;
-            snprintf(result.reasonBuf, sizeof(result.reasonBuf),
-                     "Service UUID 0x%04X (%s)",
-                     GLASSES_SERVICE_UUIDS[i].uuid16,
-                     GLASSES_SERVICE_UUIDS[i].owner);
-            result.reason = result.reasonBuf;
-            return true;
-        }
+    bool advertisesService16(uint16_t uuid) const {
+        return device_.isAdvertisingService(BLEUUID(uuid));
     }
-    return false;
-}
 
-// Check device name patterns
-bool checkDeviceName(const String& name, DetectionResult& result) {
-    if (name.length() == 0) return false;
-
-    for (int i = 0; GLASSES_NAME_PATTERNS[i].pattern != NULL; i++) {
-        if (containsIgnoreCase(name, GLASSES_NAME_PATTERNS[i].pattern)) {
-            result.detected = true;
-            result.company = GLASSES_NAME_PATTERNS[i].product;
-            result.product = GLASSES_NAME_PATTERNS[i].product;
-            result.hasCamera = GLASSES_NAME_PATTERNS[i].hasCamera;
-            result.tier = TIER_HIGH;  // Name match is high confidence
-            snprintf(result.reasonBuf, sizeof(result.reasonBuf),
-                     "Device name '%s' matches '%s'",
-                     name.c_str(), GLASSES_NAME_PATTERNS[i].pattern);
-            result.reason = result.reasonBuf;
-            return true;
+    bool name(const char*& str, size_t& len) const {
+        if (!device_.haveName()) return false;
+        if (!nameFetched_) {
+            name_ = device_.getName();
+            nameFetched_ = true;
         }
+        str = name_.c_str();
+        len = name_.length();
+        return true;
     }
-    return false;
-}
 
-// Check MAC OUI prefix (supplementary — BLE MACs can be random)
-bool checkOUIPrefix(const uint8_t* mac, DetectionResult& result) {
-    for (int i = 0; GLASSES_OUI_PREFIXES[i].vendor != NULL; i++) {
-        if (memcmp(mac, GLASSES_OUI_PREFIXES[i].oui, 3) == 0) {
-            result.detected = true;
-            result.company = GLASSES_OUI_PREFIXES[i].vendor;
-            result.product = "Smart Glasses (OUI match)";
-            result.hasCamera = true;
-            result.tier = TIER_MEDIUM;  // OUI is supplementary
-            snprintf(result.reasonBuf, sizeof(result.reasonBuf),
-                     "OUI prefix %02X:%02X:%02X (%s)",
-                     mac[0], mac[1], mac[2],
-                     GLASSES_OUI_PREFIXES[i].vendor);
-            result.reason = result.reasonBuf;
-            return true;
-        }
-    }
-    return false;
-}
+private:
+    BLEAdvertisedDevice& device_;
+    uint8_t              mac_[6];
+    mutable std::string  mfgData_;
+    mutable std::string  name_;
+    mutable bool         mfgFetched_ = false;
+    mutable bool         nameFetched_ = false;
+};
 
 // ============================================================
 // Serial JSON Output
 // ============================================================
 
-void sendDetectionJSON(BLEAdvertisedDevice& device, const DetectionResult& result) {
+void sendDetectionJSON(const BLEAdvertView& advert, const DetectionResult& result) {
     JsonDocument doc;
-    doc["type"] = "detection";
-    doc["mac"] = device.getAddress().toString().c_str();
-    doc["company"] = result.company;
-    doc["product"] = result.product;
-    doc["reason"] = result.reason;
-    doc["rssi"] = device.getRSSI();
-    doc["hasCamera"] = result.hasCamera;
-    doc["tier"] = result.tier;
-
-    if (device.haveName()) {
-        doc["deviceName"] = device.getName().c_str();
-    }
-
-    if (device.haveManufacturerData()) {
-        std::string mfgData = device.getManufacturerData();
-        if (mfgData.length() >= 2) {
-            uint16_t cid = (uint8_t)mfgData[0] | ((uint8_t)mfgData[1] << 8);
-            char cidHex[7];
-            snprintf(cidHex, sizeof(cidHex), "0x%04X", cid);
-            doc["companyId"] = cidHex;
-        }
-    }
+    buildDetectionJSON(doc, advert, result, millis());
+
+    serializeJson(doc, Serial);
+    Serial.println();
+}
 
-    doc["ts"] = millis();
+void sendWifiDetectionJSON(const WifiFrame& frame, const DetectionResult& result) {
+    JsonDocument doc;
+    buildWifiDetectionJSON(doc, frame, result, millis());
 
     serializeJson(doc, Serial);
     Serial.println();
@@ -386,17 +375,104 @@ void sendStatusJSON() {
     doc["freeHeap"] = ESP.getFreeHeap();
     doc["totalScans"] = totalScans;
     doc["totalDetections"] = totalDetections;
-    doc["trackedDevices"] = trackedDeviceCount;
+    doc["trackedDevices"] = tracker.count;
     doc["alertActive"] = alertActive;
     doc["tierHigh"] = ENABLE_TIER_HIGH;
     doc["tierMedium"] = ENABLE_TIER_MEDIUM;
     doc["tierLow"] = ENABLE_TIER_LOW;
     doc["rssiThreshold"] = RSSI_THRESHOLD_DEFAULT;
+#if ENABLE_JOURNAL
+    if (journal.mounted()) {
+        JournalStats js = journal.stats();
+        doc["journalRecords"] = js.records;
+        doc["journalDropped"] = js.dropped;
+        doc["journalTime"] = journal.now(millis());
+    }
+#endif
+#if ENABLE_WIFI_SNIFFER
+    WifiCaptureStats ws = wifiCapture.stats();
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastWifiStatsTime;
+    doc["wifiChannel"] = wifiChannel;
+    doc["wifiFramesPerSec"] = elapsed ? (ws.frames - lastWifiFrames) * 1000ULL / elapsed : 0;
+    doc["wifiFrames"] = ws.frames;
+    doc["wifiWeak"] = ws.weak;
+    doc["wifiRejected"] = ws.rejected;
+    doc["wifiCandidates"] = ws.candidates;
+    doc["wifiDropped"] = ws.dropped;
+    lastWifiFrames = ws.frames;
+    lastWifiStatsTime = now;
+#endif
+
+#if MEASURE_PIPELINE_CYCLES
+    PipelineCycleStats pc;
+    {
+        PipelineLock lock;
+        pc = pipelineCycles;
+    }
+    doc["pipelineRuns"] = pc.runs;
+    doc["pipelineCyclesAvg"] = pc.runs ? (uint32_t)(pc.total / pc.runs) : 0;
+    doc["pipelineCyclesMax"] = pc.max;
+#endif
 
     serializeJson(doc, Serial);
     Serial.println();
 }
 
+void sendBootJSON() {
+    JsonDocument doc;
+    doc["type"] = "boot";
+    doc["board"] = BOARD_TYPE;
+    doc["env"] = BUILD_ENV;
+    doc["version"] = FIRMWARE_VERSION;
+    doc["fastBoot"] = FAST_BOOT;
+    doc["resetReason"] = (int)esp_reset_reason();
+
+    // Boot phases in ms since app start (ROM bootloader time not included)
+    JsonObject ms = doc["bootMs"].to<JsonObject>();
+    ms["setup"] = bootTiming.setupUs / 1000;
+    ms["bleReady"] = bootTiming.bleReadyUs / 1000;
+    ms["scanStart"] = bootTiming.scanStartUs / 1000;
+    if (bootTiming.firstAdvertUs) {
+        ms["firstAdvert"] = bootTiming.firstAdvertUs / 1000;
+    } else {
+        ms["firstAdvert"] = nullptr;
+    }
+    if (bootTiming.firstDetectionUs) {
+        ms["firstDetection"] = bootTiming.firstDetectionUs / 1000;
+    } else {
+        ms["firstDetection"] = nullptr;
+    }
+
+    serializeJson(doc, Serial);
+    Serial.println();
+}
+
+#if ENABLE_JOURNAL
+void sendJournalStatsJSON() {
+    JournalStats js = journal.stats();
+    JsonDocument doc;
+    doc["type"] = "journal_stats";
+    doc["mounted"] = journal.mounted();
+    doc["time"] = journal.now(millis());
+    doc["boot"] = journal.boot();
+    doc["sectors"] = js.sectors;
+    doc["sectorsUsed"] = js.sectorsUsed;
+    doc["records"] = js.records;
+    doc["capacity"] = js.sectors * JOURNAL_RECORDS_PER_SECTOR;
+    doc["oldest"] = js.oldestTime;
+    doc["newest"] = js.newestTime;
+    doc["pending"] = js.pending;
+    doc["dropped"] = js.dropped;
+    doc["flushes"] = js.flushes;
+    doc["erases"] = js.erases;
+    doc["writeErrors"] = js.writeErrors;
+
+    serializeJson(doc, Serial);
+    Serial.println();
+}
+#endif
+
 void sendHeartbeatJSON() {
     JsonDocument doc;
     doc["type"] = "heartbeat";
@@ -411,65 +487,94 @@ void sendHeartbeatJSON() {
 // BLE Scan Callback
 // ============================================================
 
-class GlassholeScanCallbacks : public BLEAdvertisedDeviceCallbacks {
-    void onResult(BLEAdvertisedDevice advertisedDevice) override {
-        int rssi = advertisedDevice.getRSSI();
-
-        // RSSI gate — ignore weak signals
-        if (rssi < RSSI_THRESHOLD_DEFAULT) return;
-
-        DetectionResult result = {};
-        bool detected = false;
-
-        // 1. Check manufacturer-specific company ID (primary method)
-        if (!detected && advertisedDevice.haveManufacturerData()) {
-            std::string mfgData = advertisedDevice.getManufacturerData();
-            if (mfgData.length() >= 2) {
-                uint16_t companyId = (uint8_t)mfgData[0] | ((uint8_t)mfgData[1] << 8);
-                detected = checkCompanyID(companyId, result);
-            }
-        }
-
-        // 2. Check service UUIDs
-        if (!detected) {
-            detected = checkServiceUUIDs(advertisedDevice, result);
-        }
-
-        // 3. Check device name patterns
-        if (!detected && advertisedDevice.haveName()) {
-            String name = advertisedDevice.getName().c_str();
-            detected = checkDeviceName(name, result);
-        }
-
-        // 4. Check MAC OUI prefix (supplementary)
-        if (!detected) {
-            const uint8_t* nativeAddr = *advertisedDevice.getAddress().getNative();
-            detected = checkOUIPrefix(nativeAddr, result);
-        }
+// Side effects of an alert, run in order by the pipeline
+struct AlertSink {
+    template <typename Adv>
+    void operator()(const Adv& advert, const DetectionResult& result) const {
+        if (!bootTiming.firstDetectionUs) bootTiming.firstDetectionUs = micros();
+        totalDetections++;
+        triggerAlert(advert.rssi(), result.tier, result.hasCamera);
+    }
+};
 
-        if (!detected) return;
+#if ENABLE_JOURNAL
+// Queue only; loop() writes to flash
+struct JournalSink {
+    template <typename Adv>
+    void operator()(const Adv& advert, const DetectionResult& result) const {
+        journal.append(makeJournalRecord(advert.mac(), advert.rssi(), result, millis()));
+    }
+};
+#else
+typedef NoSink JournalSink;
+#endif
 
-        // --- Detection confirmed ---
+struct SerialSink {
+    void operator()(const BLEAdvertView& advert, const DetectionResult& result) const {
+        sendDetectionJSON(advert, result);
+    }
 
-        // Get MAC for deduplication
-        const uint8_t* mac = *advertisedDevice.getAddress().getNative();
+    void operator()(const WifiFrame& frame, const DetectionResult& result) const {
+        sendWifiDetectionJSON(frame, result);
+    }
+};
 
-        // Check cooldown
-        if (isDeviceCoolingDown(mac)) return;
+typedef SinkChain<AlertSink, JournalSink, SerialSink> GlassholeSinks;
 
-        // Track this device
-        trackDevice(mac, rssi, result.tier, result.hasCamera);
+class GlassholeScanCallbacks : public BLEAdvertisedDeviceCallbacks {
+    void onResult(BLEAdvertisedDevice advertisedDevice) override {
+        if (!bootTiming.firstAdvertUs) bootTiming.firstAdvertUs = micros();
+
+        // RSSI gate, matchers, cooldown and tracking, then the sinks
+        BLEAdvertView advert(advertisedDevice);
+        PipelineLock lock;
+#if MEASURE_PIPELINE_CYCLES
+        DetectionResult result;
+        uint32_t start = ESP.getCycleCount();
+        bool alert = GlassholePipeline::process(advert, tracker, millis(), result);
+        uint32_t cycles = ESP.getCycleCount() - start;
+        pipelineCycles.runs++;
+        pipelineCycles.total += cycles;
+        if (cycles > pipelineCycles.max) pipelineCycles.max = cycles;
+        if (alert) GlassholeSinks()(advert, result);
+#else
+        GlassholePipeline::run(advert, tracker, millis(), GlassholeSinks());
+#endif
+    }
+};
 
-        // Update counters
-        totalDetections++;
+#if ENABLE_WIFI_SNIFFER
+// ============================================================
+// Wi-Fi Promiscuous Callback
+// ============================================================
 
-        // Trigger LED alert
-        triggerAlert(rssi, result.tier, result.hasCamera);
+// Runs on the Wi-Fi task for every frame: header parse and pre-filter
+// only, matching happens in loop()
+void onPromiscuousFrame(void* buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT && type != WIFI_PKT_DATA) return;
+    const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+    size_t len = pkt->rx_ctrl.sig_len;
+    len = len > 4 ? len - 4 : 0;   // sig_len counts the FCS
+    wifiCapture.onFrame(pkt->payload, len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel);
+}
 
-        // Send JSON to serial
-        sendDetectionJSON(advertisedDevice, result);
+// Match queued frames against the Wi-Fi pipeline. Bounded so a frame
+// storm cannot hold up the LED and serial handling.
+void serviceWifiSniffer() {
+    WifiFrame frame;
+    for (int i = 0; i < WIFI_QUEUE_FRAMES && wifiCapture.pop(frame); i++) {
+        PipelineLock lock;
+        WifiPipeline::run(frame, tracker, millis(), GlassholeSinks());
     }
-};
+}
+
+void hopWifiChannel(uint32_t now) {
+    if (now - lastHopTime < WIFI_HOP_INTERVAL_MS) return;
+    wifiChannel = wifiChannel % WIFI_CHANNEL_COUNT + 1;
+    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+    lastHopTime = now;
+}
+#endif
 
 // ============================================================
 // Async Scan Complete Callback
@@ -481,20 +586,142 @@ void onScanComplete(BLEScanResults results) {
 }
 
 // ============================================================
-// Setup
+// Serial Commands
 // ============================================================
+// {"cmd":"journal","from":T0,"to":T1,"companyId":"0x058E","limit":N}
+//   Records with T0 <= time <= T1 (journal seconds, all optional), at
+//   most N (1..JOURNAL_QUERY_LIMIT), one "journal" line each, then a
+//   "journal_end" summary.
+// {"cmd":"journal_stats"}
+
+#if ENABLE_JOURNAL
+// Reply to a journal query in progress. Records go out a few per loop()
+// pass so scanning, LED and journal writes keep running meanwhile.
+struct JournalReply {
+    JournalCursor cursor;
+    uint32_t      limit;
+    uint32_t      sent;
+    uint32_t      startUs;
+    bool          truncated;
+    bool          active;
+};
 
-void setup() {
-    Serial.begin(SERIAL_BAUD);
-    delay(500);
+JournalReply journalReply;
+
+void runJournalQuery(JsonDocument& cmd) {
+    if (journalReply.active) {
+        Serial.println("{\"type\":\"error\",\"msg\":\"journal query already running\"}");
+        return;
+    }
+
+    uint32_t from = cmd["from"] | 0UL;
+    uint32_t to = cmd["to"] | 0xFFFFFFFFUL;
+    uint32_t limit = cmd["limit"] | (uint32_t)JOURNAL_QUERY_LIMIT;
+    if (limit == 0) {
+        Serial.println("{\"type\":\"error\",\"msg\":\"limit must be at least 1\"}");
+        return;
+    }
+    if (limit > JOURNAL_QUERY_LIMIT) limit = JOURNAL_QUERY_LIMIT;
+
+    int company = JOURNAL_ANY_COMPANY;
+    const char* cid = cmd["companyId"];
+    if (cid) {
+        company = journalCompanyIndex((uint16_t)strtoul(cid, nullptr, 16));
+        if (company < 0) {
+            Serial.println("{\"type\":\"error\",\"msg\":\"companyId not in database\"}");
+            return;
+        }
+    }
 
-    // Configure LED
+    journalReply.startUs = micros();
+    journalReply.cursor = journal.startQuery(from, to, company);
+    journalReply.limit = limit;
+    journalReply.sent = 0;
+    journalReply.truncated = false;
+    journalReply.active = true;
+}
+
+// Called from loop(): send the next few records, then the summary. One
+// match past the limit is looked at (not sent) to tell whether the reply
+// was cut short.
+void serviceJournalReply() {
+    JournalReply& r = journalReply;
+    if (!r.active) return;
+
+    uint32_t budget = r.limit - r.sent + 1;
+    if (budget > JOURNAL_QUERY_CHUNK) budget = JOURNAL_QUERY_CHUNK;
+    bool more = journal.resume(r.cursor, budget, [&](const JournalRecord& rec) {
+        if (r.sent == r.limit) {
+            r.truncated = true;
+            return false;
+        }
+        JsonDocument doc;
+        buildJournalJSON(doc, rec);
+        serializeJson(doc, Serial);
+        Serial.println();
+        r.sent++;
+        return true;
+    });
+    if (more) return;
+
+    const JournalQueryStats& qs = r.cursor.stats;
+    JsonDocument doc;
+    doc["type"] = "journal_end";
+    doc["matched"] = r.sent;
+    doc["truncated"] = r.truncated;
+    doc["sectorsScanned"] = qs.sectorsScanned;
+    doc["sectorsSkipped"] = qs.sectorsSkipped;
+    doc["recordsRead"] = qs.recordsRead;
+    doc["us"] = micros() - r.startUs;
+    serializeJson(doc, Serial);
+    Serial.println();
+    r.active = false;
+}
+#endif
+
+void handleCommand(const char* line, size_t len) {
+    JsonDocument cmd;
+    if (deserializeJson(cmd, line, len)) return;   // Not JSON: ignore
+
+    const char* name = cmd["cmd"];
+    if (!name) return;
+#if ENABLE_JOURNAL
+    if (strcmp(name, "journal") == 0) {
+        runJournalQuery(cmd);
+    } else if (strcmp(name, "journal_stats") == 0) {
+        sendJournalStatsJSON();
+    }
+#endif
+}
+
+void pollSerialCommands() {
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r') continue;
+        if (c == '\n') {
+            if (!commandOverflow) handleCommand(commandBuf, commandLen);
+            commandLen = 0;
+            commandOverflow = false;
+        } else if (commandLen < sizeof(commandBuf)) {
+            commandBuf[commandLen++] = c;
+        } else {
+            commandOverflow = true;   // Drop the whole line
+        }
+    }
+}
+
+// ============================================================
+// Setup
+// ============================================================
+
+void initLED() {
 #if !HAS_RGB_LED
     pinMode(LED_PIN, OUTPUT);
 #endif
     ledOff();
+}
 
-    // Boot banner
+void printBanner() {
     Serial.println();
     Serial.println("========================================");
     Serial.println("  ESP-GlassHole — AR Glasses Detector");
@@ -507,29 +734,100 @@ void setup() {
                   ENABLE_TIER_MEDIUM ? "ON" : "OFF",
                   ENABLE_TIER_LOW ? "ON" : "OFF");
     Serial.printf("  DB:     %d company IDs, %d OUI prefixes\n",
-                  GLASSES_COMPANY_ID_COUNT,
-                  (int)(sizeof(GLASSES_OUI_PREFIXES) / sizeof(GLASSES_OUI_PREFIXES[0])) - 1);
+                  GLASSES_COMPANY_ID_COUNT, GLASSES_OUI_PREFIX_COUNT);
+#if ENABLE_WIFI_SNIFFER
+    Serial.printf("  Wi-Fi:  sniffer on, channels 1-%d, %d ms dwell\n",
+                  WIFI_CHANNEL_COUNT, WIFI_HOP_INTERVAL_MS);
+#endif
     Serial.println("========================================");
     Serial.println();
+}
 
-    // Initialize BLE
+void initBLE() {
     BLEDevice::init("ESP-GlassHole");
     pBLEScan = BLEDevice::getScan();
     pBLEScan->setAdvertisedDeviceCallbacks(new GlassholeScanCallbacks(), true);
     pBLEScan->setActiveScan(true);
     pBLEScan->setInterval(160);   // 100ms in 0.625ms units
     pBLEScan->setWindow(128);     // 80ms in 0.625ms units
+    bootTiming.bleReadyUs = micros();
+}
 
-    // Boot flash — 3 quick blinks to show we're alive
-    for (int i = 0; i < 3; i++) {
+// Index the journal partition: headers and footers only, ~2 reads/sector
+void initJournal() {
+#if ENABLE_JOURNAL
+    if (!journalFlash.begin() || !journal.mount()) {
+        Serial.println("{\"type\":\"error\",\"msg\":\"journal partition not found\"}");
+    }
+#endif
+}
+
+// Promiscuous capture of management and data frames, after BLE so the
+// scan starts first. The coexistence scheduler shares the radio.
+void initWifiSniffer() {
+#if ENABLE_WIFI_SNIFFER
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+
+    wifi_promiscuous_filter_t filter = {};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA;
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(&onPromiscuousFrame);
+    if (esp_wifi_set_promiscuous(true) != ESP_OK) {
+        Serial.println("{\"type\":\"error\",\"msg\":\"wifi promiscuous mode failed\"}");
+        return;
+    }
+    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+    lastHopTime = millis();
+    lastWifiStatsTime = millis();
+#endif
+}
+
+// Start async BLE scan if not already running
+void startScan() {
+    if (scanInProgress) return;
+    pBLEScan->clearResults();
+    pBLEScan->start(BLE_SCAN_TIME, onScanComplete, false);
+    scanInProgress = true;
+    if (!bootTiming.scanStartUs) bootTiming.scanStartUs = micros();
+}
+
+void setup() {
+    bootTiming.setupUs = micros();
+    Serial.begin(SERIAL_BAUD);
+#if ENABLE_WIFI_SNIFFER
+    pipelineMutex = xSemaphoreCreateMutex();
+#endif
+
+#if FAST_BOOT
+    // Scanning first; LED, boot flash and banner follow without blocking
+    initBLE();
+    startScan();
+
+    // Detections queue in RAM until the journal is mounted
+    initJournal();
+    initWifiSniffer();
+    initLED();
+    bootFlashStart = millis();
+    bootFlashActive = true;
+    bannerPending = true;
+#else
+    delay(500);
+    initLED();
+    printBanner();
+    initJournal();
+    initBLE();
+    initWifiSniffer();
+
+    // Boot flash — quick blinks to show we're alive
+    for (int i = 0; i < BOOT_FLASH_BLINKS; i++) {
         ledOn();
         delay(100);
         ledOff();
         delay(100);
     }
     ledIdle();
-
-    Serial.println("{\"type\":\"boot\",\"board\":\"" BOARD_TYPE "\",\"version\":\"2.0.0\"}");
+#endif
 
     lastStatusTime = millis();
     lastHeartbeatTime = millis();
@@ -540,16 +838,39 @@ void setup() {
 // ============================================================
 
 void loop() {
-    // Start async BLE scan if not already running
-    if (!scanInProgress) {
-        pBLEScan->clearResults();
-        pBLEScan->start(BLE_SCAN_TIME, onScanComplete, false);
-        scanInProgress = true;
+    startScan();
+
+    // Deferred banner — scanning is already running on the BLE task
+    if (bannerPending) {
+        printBanner();
+        bannerPending = false;
+    }
+
+    // Boot report once the first detection is in, or after a timeout
+    if (!bootReported && bootTiming.scanStartUs &&
+        (bootTiming.firstDetectionUs ||
+         micros() - bootTiming.scanStartUs >= BOOT_REPORT_TIMEOUT_MS * 1000UL)) {
+        sendBootJSON();
+        bootReported = true;
     }
 
     // Update LED state (runs every loop iteration — smooth blinking)
     updateLED();
 
+    pollSerialCommands();
+
+#if ENABLE_WIFI_SNIFFER
+    // Match frames queued by the promiscuous callback, then hop
+    serviceWifiSniffer();
+    hopWifiChannel(millis());
+#endif
+
+#if ENABLE_JOURNAL
+    // Batched journal writes, then the next part of a query reply
+    journal.service(millis());
+    serviceJournalReply();
+#endif
+
     // Periodic status
     uint32_t now = millis();
     if (now - lastStatusTime >= STATUS_INTERVAL_MS) {
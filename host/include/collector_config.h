@@ -0,0 +1,40 @@
+/*
+ * ESP-GlassHole — Host Collector Configuration
+ */
+
+#ifndef COLLECTOR_CONFIG_H
+#define COLLECTOR_CONFIG_H
+
+// ============================================================
+// Serial Ports
+// ============================================================
+#define COLLECTOR_MAX_SENSORS      16      // Max serial ports per collector
+#define COLLECTOR_LINE_BUFFER      1024    // Per-port line buffer (bytes)
+#define COLLECTOR_RECONNECT_MS     2000    // Retry interval for lost ports
+
+// ============================================================
+// Event Store
+// ============================================================
+#define COLLECTOR_EVENT_LOG_SIZE   4096    // Global time-ordered event ring
+#define COLLECTOR_DEVICE_HISTORY   64      // Events kept per device
+#define COLLECTOR_DEVICE_EXPIRE_MS 300000  // Forget devices idle for 5 min
+
+// ============================================================
+// Localization
+// ============================================================
+// Path-loss model: rssi = txPower - 10 * n * log10(distance_m)
+#define LOCALIZE_MIN_SENSORS       3       // Placed sensors needed for a fix
+#define LOCALIZE_WINDOW_MS         12000   // Max age of a sensor's RSSI (> cooldown)
+#define LOCALIZE_RSSI_SIGMA_DB     4.0     // Per-sample RSSI noise
+#define LOCALIZE_PRIOR_TAU_MS      5000    // How fast the previous fix loses weight
+#define LOCALIZE_TX_POWER_DEFAULT  -59.0   // Expected RSSI at 1 m
+#define LOCALIZE_EXPONENT_DEFAULT  2.5     // Indoor path-loss exponent
+
+// ============================================================
+// Metrics Endpoint
+// ============================================================
+#define COLLECTOR_METRICS_ADDR     "127.0.0.1"
+#define COLLECTOR_METRICS_PORT     9464
+#define COLLECTOR_SEND_TIMEOUT_MS  1000    // Drop scrapers that stall this long
+
+#endif // COLLECTOR_CONFIG_H
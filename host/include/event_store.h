@@ -0,0 +1,223 @@
+/*
+ * ESP-GlassHole — Multi-Sensor Event Store
+ *
+ * Merges detections from every connected sensor into one time-ordered
+ * log plus a per-device history, keyed by MAC. Sensor timestamps are
+ * millis() since that unit booted, so each sensor gets a SensorClock
+ * that maps its ts onto the collector's monotonic clock.
+ */
+
+#ifndef EVENT_STORE_H
+#define EVENT_STORE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "collector_config.h"
+#include "serial_stream.h"
+
+// ============================================================
+// Sensor Clock Alignment
+// ============================================================
+// offset = hostMs - sensorTs. The smallest offset seen is the sample with
+// the least serial/USB latency, so we track the minimum. It is relaxed by
+// CLOCK_DRIFT_PPM so a slow sensor crystal can't pin it forever. The
+// relaxation is well under 1 ms between lines, so the fraction is carried
+// from call to call instead of being truncated away.
+
+#define CLOCK_DRIFT_PPM 100
+
+struct SensorClock {
+    int64_t  offset = 0;
+    double   drift = 0.0;      // Relaxation not yet applied to offset (ms)
+    uint64_t lastHostMs = 0;
+    uint32_t lastSensorTs = 0;
+    bool     valid = false;
+
+    void reset() { valid = false; }
+
+    uint64_t align(uint32_t sensorTs, uint64_t hostMs) {
+        int64_t sample = (int64_t)hostMs - (int64_t)sensorTs;
+
+        // Sensor rebooted (or millis() wrapped) — start over
+        if (valid && sensorTs < lastSensorTs) valid = false;
+
+        if (!valid) {
+            offset = sample;
+            drift = 0.0;
+            valid = true;
+        } else {
+            drift += (double)(hostMs - lastHostMs) * (CLOCK_DRIFT_PPM / 1e6);
+            int64_t whole = (int64_t)drift;
+            offset += whole;
+            drift -= (double)whole;
+            if (sample < offset) {
+                offset = sample;
+                drift = 0.0;
+            }
+        }
+        lastHostMs = hostMs;
+        lastSensorTs = sensorTs;
+        return (uint64_t)((int64_t)sensorTs + offset);
+    }
+};
+
+// ============================================================
+// Records
+// ============================================================
+
+struct StoredEvent {
+    uint64_t timeMs;      // Aligned to the collector clock
+    uint64_t deviceKey;
+    uint32_t sensorTs;    // Raw sensor millis()
+    uint16_t sensor;
+    int8_t   rssi;
+    uint8_t  tier;
+};
+
+struct DeviceRecord {
+    uint8_t     mac[6];
+    std::string company;
+    std::string product;
+    uint16_t    companyId = 0;
+    bool        hasCompanyId = false;
+    bool        hasCamera = false;
+    uint8_t     tier = 0;
+    uint64_t    firstSeenMs = 0;
+    uint64_t    lastSeenMs = 0;
+    uint32_t    detections = 0;
+    uint32_t    sensorMask = 0;   // Bit per sensor that has seen it
+    int8_t      lastRssi[COLLECTOR_MAX_SENSORS];
+    std::deque<StoredEvent> history;   // Oldest first
+};
+
+inline uint64_t macKey(const uint8_t mac[6]) {
+    uint64_t k = 0;
+    for (int i = 0; i < 6; i++) k = (k << 8) | mac[i];
+    return k;
+}
+
+// ============================================================
+// Event Store
+// ============================================================
+
+class EventStore {
+public:
+    EventStore() : log_(COLLECTOR_EVENT_LOG_SIZE) {}
+
+    // Insert a detection. `timeMs` is the aligned event time; arrivals from
+    // different ports may be slightly out of order and are sorted in.
+    DeviceRecord& add(const SensorMessage& msg, uint16_t sensor, uint64_t timeMs) {
+        StoredEvent ev;
+        ev.timeMs = timeMs;
+        ev.deviceKey = macKey(msg.mac);
+        ev.sensorTs = msg.ts;
+        ev.sensor = sensor;
+        ev.rssi = (int8_t)msg.rssi;
+        ev.tier = msg.tier;
+
+        auto it = devices_.find(ev.deviceKey);
+        if (it == devices_.end()) {
+            it = devices_.emplace(ev.deviceKey, DeviceRecord()).first;
+            DeviceRecord& d = it->second;
+            memcpy(d.mac, msg.mac, 6);
+            memset(d.lastRssi, 0, sizeof(d.lastRssi));
+            d.firstSeenMs = timeMs;
+        }
+
+        DeviceRecord& d = it->second;
+        if (d.product.empty() && !msg.product.empty()) {
+            d.company.assign(msg.company.data(), msg.company.size());
+            d.product.assign(msg.product.data(), msg.product.size());
+        }
+        if (msg.hasCompanyId) {
+            d.companyId = msg.companyId;
+            d.hasCompanyId = true;
+        }
+        d.hasCamera = msg.hasCamera;
+        d.tier = msg.tier;
+        if (timeMs > d.lastSeenMs) d.lastSeenMs = timeMs;
+        if (timeMs < d.firstSeenMs) d.firstSeenMs = timeMs;
+        d.detections++;
+        if (sensor < COLLECTOR_MAX_SENSORS) {
+            d.sensorMask |= (1u << sensor);
+            d.lastRssi[sensor] = ev.rssi;
+        }
+
+        insertSorted(d.history, ev);
+        if (d.history.size() > COLLECTOR_DEVICE_HISTORY) d.history.pop_front();
+
+        appendLog(ev);
+        totalEvents_++;
+        return d;
+    }
+
+    // Drop devices that no sensor has reported recently
+    void expire(uint64_t nowMs) {
+        for (auto it = devices_.begin(); it != devices_.end();) {
+            if (nowMs - it->second.lastSeenMs > COLLECTOR_DEVICE_EXPIRE_MS) {
+                it = devices_.erase(it);
+                expiredDevices_++;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Visit the global log oldest-first
+    template <typename F>
+    void forEachEvent(F&& fn) const {
+        size_t cap = log_.size();
+        size_t first = (logHead_ + cap - logCount_) % cap;
+        for (size_t i = 0; i < logCount_; i++) fn(log_[(first + i) % cap]);
+    }
+
+    const std::unordered_map<uint64_t, DeviceRecord>& devices() const { return devices_; }
+    uint64_t totalEvents()    const { return totalEvents_; }
+    uint64_t reordered()      const { return reordered_; }
+    uint64_t expiredDevices() const { return expiredDevices_; }
+    size_t   logSize()        const { return logCount_; }
+
+private:
+    std::unordered_map<uint64_t, DeviceRecord> devices_;
+    std::vector<StoredEvent> log_;    // Ring buffer
+    size_t   logHead_ = 0;            // Next write slot
+    size_t   logCount_ = 0;
+    uint64_t totalEvents_ = 0;
+    uint64_t reordered_ = 0;
+    uint64_t expiredDevices_ = 0;
+
+    void insertSorted(std::deque<StoredEvent>& q, const StoredEvent& ev) {
+        auto pos = q.end();
+        while (pos != q.begin() && (pos - 1)->timeMs > ev.timeMs) --pos;
+        q.insert(pos, ev);
+    }
+
+    // Append, then bubble back past any newer entries (usually zero steps)
+    void appendLog(const StoredEvent& ev) {
+        size_t cap = log_.size();
+        size_t i = logHead_;
+        log_[i] = ev;
+        logHead_ = (logHead_ + 1) % cap;
+        if (logCount_ < cap) logCount_++;
+
+        size_t steps = logCount_ - 1;
+        bool moved = false;
+        while (steps-- > 0) {
+            size_t prev = (i + cap - 1) % cap;
+            if (log_[prev].timeMs <= log_[i].timeMs) break;
+            StoredEvent tmp = log_[prev];
+            log_[prev] = log_[i];
+            log_[i] = tmp;
+            i = prev;
+            moved = true;
+        }
+        if (moved) reordered_++;
+    }
+};
+
+#endif // EVENT_STORE_H
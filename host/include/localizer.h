@@ -0,0 +1,345 @@
+/*
+ * ESP-GlassHole — Multi-Sensor RSSI Localization
+ *
+ * Each detection updates one (device, sensor) RSSI slot. A device's first
+ * fix is a weighted Gauss-Newton solve over the slots younger than
+ * LOCALIZE_WINDOW_MS from placed sensors, each converted to a range through
+ * that sensor's path-loss model. After that every sample is an iterated
+ * EKF-style update: the new range alone, against the previous fix as a
+ * prior whose information decays with time. Samples already folded into
+ * the fix are never used again, so each is counted once and sigma stays
+ * honest. A track that goes quiet for longer than the window restarts
+ * from the slots.
+ *
+ * Per-sensor path-loss models are fitted online by recursive least squares
+ * from reference devices ("anchors") left at known positions, so
+ * txPower/exponent adapt to each unit's placement and antenna.
+ *
+ * Only BLE detections are fed in; the collector keeps Wi-Fi sniffer
+ * detections out, since their transmit power has nothing to do with the
+ * BLE models.
+ */
+
+#ifndef LOCALIZER_H
+#define LOCALIZER_H
+
+#include <math.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "collector_config.h"
+
+#define LOCALIZE_MIN_RANGE_M     0.3
+#define LOCALIZE_MAX_RANGE_M     60.0
+#define LOCALIZE_MAX_ITERATIONS  5
+#define LOCALIZE_CAL_FORGET      0.999   // RLS forgetting factor
+
+// ============================================================
+// Path-Loss Model
+// ============================================================
+// rssi = txPower - 10 * n * log10(d), fitted online as a linear model
+// in theta = [txPower, n] with regressor phi = [1, -10 * log10(d)].
+
+struct PathLossModel {
+    double txPower  = LOCALIZE_TX_POWER_DEFAULT;
+    double exponent = LOCALIZE_EXPONENT_DEFAULT;
+    double P[2][2]  = { { 25.0, 0.0 }, { 0.0, 0.25 } };   // Parameter covariance
+    uint32_t samples = 0;
+
+    double distance(double rssi) const {
+        double d = pow(10.0, (txPower - rssi) / (10.0 * exponent));
+        if (d < LOCALIZE_MIN_RANGE_M) d = LOCALIZE_MIN_RANGE_M;
+        if (d > LOCALIZE_MAX_RANGE_M) d = LOCALIZE_MAX_RANGE_M;
+        return d;
+    }
+
+    // Range standard deviation for a given range, from the RSSI noise
+    double rangeSigma(double d) const {
+        return d * (M_LN10 / (10.0 * exponent)) * LOCALIZE_RSSI_SIGMA_DB;
+    }
+
+    void update(double distance, double rssi) {
+        if (distance < LOCALIZE_MIN_RANGE_M) distance = LOCALIZE_MIN_RANGE_M;
+        double phi0 = 1.0;
+        double phi1 = -10.0 * log10(distance);
+
+        double Pphi0 = P[0][0] * phi0 + P[0][1] * phi1;
+        double Pphi1 = P[1][0] * phi0 + P[1][1] * phi1;
+        double denom = LOCALIZE_CAL_FORGET + phi0 * Pphi0 + phi1 * Pphi1;
+        double k0 = Pphi0 / denom;
+        double k1 = Pphi1 / denom;
+
+        double err = rssi - (txPower * phi0 + exponent * phi1);
+        txPower  += k0 * err;
+        exponent += k1 * err;
+
+        double P00 = (P[0][0] - k0 * Pphi0) / LOCALIZE_CAL_FORGET;
+        double P01 = (P[0][1] - k0 * Pphi1) / LOCALIZE_CAL_FORGET;
+        double P11 = (P[1][1] - k1 * Pphi1) / LOCALIZE_CAL_FORGET;
+        P[0][0] = P00;
+        P[0][1] = P[1][0] = P01;
+        P[1][1] = P11;
+
+        // Keep the model physical even if a fix was wrong
+        if (exponent < 1.6) exponent = 1.6;
+        if (exponent > 4.5) exponent = 4.5;
+        if (txPower < -85.0) txPower = -85.0;
+        if (txPower > -30.0) txPower = -30.0;
+        samples++;
+    }
+};
+
+struct SensorSite {
+    double        x = 0.0;
+    double        y = 0.0;
+    bool          placed = false;
+    PathLossModel model;
+};
+
+// ============================================================
+// Device Tracks
+// ============================================================
+
+struct RssiSlot {
+    double   rssi = 0.0;     // Smoothed over samples inside the window
+    uint64_t timeMs = 0;
+    bool     valid = false;
+};
+
+struct PositionFix {
+    double   x = 0.0;
+    double   y = 0.0;
+    double   sigma = 0.0;    // sqrt(trace(covariance)), metres
+    double   chi2 = 0.0;     // Normalised residual of the ranges used
+    uint8_t  sensors = 0;
+    uint64_t timeMs = 0;
+};
+
+struct DeviceTrack {
+    RssiSlot    slots[COLLECTOR_MAX_SENSORS];
+    PositionFix fix;
+    double      info[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };   // Inverse covariance of fix
+    bool        hasFix = false;
+    uint64_t    lastMs = 0;
+};
+
+// ============================================================
+// Localizer
+// ============================================================
+
+class Localizer {
+public:
+    std::vector<SensorSite> sites;
+
+    explicit Localizer(size_t sensorCount = 0) : sites(sensorCount) {}
+
+    size_t placedCount() const {
+        size_t n = 0;
+        for (const SensorSite& s : sites) if (s.placed) n++;
+        return n;
+    }
+
+    bool enabled() const { return placedCount() >= LOCALIZE_MIN_SENSORS; }
+
+    // A reference device at a known position. Its detections calibrate the
+    // reporting sensor's model instead of producing fixes.
+    void addAnchor(uint64_t deviceKey, double x, double y) {
+        anchors_[deviceKey] = { x, y };
+    }
+
+    // Feed one RSSI sample. Returns true and fills `out` when the device
+    // has a new position fix.
+    bool update(uint64_t deviceKey, uint16_t sensor, int rssi, uint64_t timeMs,
+                PositionFix& out) {
+        if (sensor >= sites.size() || !sites[sensor].placed) return false;
+
+        auto anchor = anchors_.find(deviceKey);
+        if (anchor != anchors_.end()) {
+            SensorSite& site = sites[sensor];
+            double dx = anchor->second.x - site.x;
+            double dy = anchor->second.y - site.y;
+            site.model.update(sqrt(dx * dx + dy * dy), rssi);
+            calibrations_++;
+            return false;
+        }
+
+        DeviceTrack& t = tracks_[deviceKey];
+        t.lastMs = timeMs > t.lastMs ? timeMs : t.lastMs;
+
+        RssiSlot& slot = t.slots[sensor];
+        if (slot.valid && timeMs >= slot.timeMs &&
+            timeMs - slot.timeMs < LOCALIZE_WINDOW_MS) {
+            slot.rssi = 0.5 * slot.rssi + 0.5 * rssi;
+        } else {
+            slot.rssi = rssi;
+        }
+        if (timeMs > slot.timeMs || !slot.valid) slot.timeMs = timeMs;
+        slot.valid = true;
+
+        if (!solve(t, sensor, rssi, timeMs)) return false;
+        updates_++;
+        out = t.fix;
+        return true;
+    }
+
+    void expire(uint64_t nowMs) {
+        for (auto it = tracks_.begin(); it != tracks_.end();) {
+            if (nowMs > it->second.lastMs &&
+                nowMs - it->second.lastMs > COLLECTOR_DEVICE_EXPIRE_MS) {
+                it = tracks_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    size_t   trackCount() const { return tracks_.size(); }
+    uint64_t updates()    const { return updates_; }
+    uint64_t rejected()   const { return rejected_; }
+    uint64_t calibrations() const { return calibrations_; }
+
+private:
+    struct Range {
+        uint16_t sensor;
+        double   d;
+        double   w;       // 1 / sigma^2
+    };
+
+    struct Anchor {
+        double x;
+        double y;
+    };
+
+    std::unordered_map<uint64_t, DeviceTrack> tracks_;
+    std::unordered_map<uint64_t, Anchor>      anchors_;
+    uint64_t updates_ = 0;
+    uint64_t rejected_ = 0;
+    uint64_t calibrations_ = 0;
+
+    Range makeRange(uint16_t sensor, double rssi) const {
+        const PathLossModel& m = sites[sensor].model;
+        double d = m.distance(rssi);
+        double sigma = m.rangeSigma(d);
+        return { sensor, d, 1.0 / (sigma * sigma) };
+    }
+
+    // `sensor` just reported `rssi`; its slot is already updated
+    bool solve(DeviceTrack& t, uint16_t sensor, int rssi, uint64_t timeMs) {
+        Range ranges[COLLECTOR_MAX_SENSORS];
+        int n = 0;
+        for (uint16_t i = 0; i < sites.size() && i < COLLECTOR_MAX_SENSORS; i++) {
+            const RssiSlot& s = t.slots[i];
+            if (!sites[i].placed || !s.valid) continue;
+            uint64_t age = timeMs > s.timeMs ? timeMs - s.timeMs : s.timeMs - timeMs;
+            if (age > LOCALIZE_WINDOW_MS) continue;
+            ranges[n++] = makeRange(i, s.rssi);
+        }
+        if (n < LOCALIZE_MIN_SENSORS) return false;
+        int used = n;
+
+        // Tracking: the previous fix already holds every earlier sample, so
+        // only the new one is added to its decayed information
+        double priorScale = 0.0;
+        if (t.hasFix) {
+            uint64_t age = timeMs > t.fix.timeMs ? timeMs - t.fix.timeMs : t.fix.timeMs - timeMs;
+            if (age <= LOCALIZE_WINDOW_MS) {
+                double dt = timeMs > t.fix.timeMs ? (double)(timeMs - t.fix.timeMs) : 0.0;
+                priorScale = 1.0 / (1.0 + dt / LOCALIZE_PRIOR_TAU_MS);
+                ranges[0] = makeRange(sensor, rssi);
+                used = 1;
+            }
+        }
+
+        // Start from the previous fix, or an inverse-range weighted centroid
+        double px, py;
+        if (t.hasFix) {
+            px = t.fix.x;
+            py = t.fix.y;
+        } else {
+            double sw = 0.0;
+            px = py = 0.0;
+            for (int k = 0; k < n; k++) {
+                double w = 1.0 / (ranges[k].d * ranges[k].d);
+                px += w * sites[ranges[k].sensor].x;
+                py += w * sites[ranges[k].sensor].y;
+                sw += w;
+            }
+            px /= sw;
+            py /= sw;
+        }
+
+        double H[2][2] = { { 0, 0 }, { 0, 0 } };
+        double chi2 = 0.0;
+        for (int iter = 0; iter < LOCALIZE_MAX_ITERATIONS; iter++) {
+            double g0 = 0.0, g1 = 0.0;
+            H[0][0] = H[0][1] = H[1][1] = 0.0;
+            chi2 = 0.0;
+
+            for (int k = 0; k < used; k++) {
+                const SensorSite& s = sites[ranges[k].sensor];
+                double dx = px - s.x;
+                double dy = py - s.y;
+                double r = sqrt(dx * dx + dy * dy);
+                if (r < 1e-3) { dx = 1e-3; dy = 0.0; r = 1e-3; }
+                double jx = dx / r;
+                double jy = dy / r;
+                double res = r - ranges[k].d;
+                double w = ranges[k].w;
+                H[0][0] += w * jx * jx;
+                H[0][1] += w * jx * jy;
+                H[1][1] += w * jy * jy;
+                g0 += w * jx * res;
+                g1 += w * jy * res;
+                chi2 += w * res * res;
+            }
+
+            if (priorScale > 0.0) {
+                double ex = px - t.fix.x;
+                double ey = py - t.fix.y;
+                double i00 = t.info[0][0] * priorScale;
+                double i01 = t.info[0][1] * priorScale;
+                double i11 = t.info[1][1] * priorScale;
+                H[0][0] += i00;
+                H[0][1] += i01;
+                H[1][1] += i11;
+                g0 += i00 * ex + i01 * ey;
+                g1 += i01 * ex + i11 * ey;
+            }
+
+            // Small Levenberg damping keeps collinear geometry solvable
+            double damp = 1e-6 * (H[0][0] + H[1][1]) + 1e-9;
+            double a = H[0][0] + damp, b = H[0][1], c = H[1][1] + damp;
+            double det = a * c - b * b;
+            if (det <= 0.0) {
+                rejected_++;
+                return false;
+            }
+            double sx = -( c * g0 - b * g1) / det;
+            double sy = -(-b * g0 + a * g1) / det;
+            px += sx;
+            py += sy;
+            if (sx * sx + sy * sy < 1e-4) break;   // < 1 cm
+        }
+
+        double det = H[0][0] * H[1][1] - H[0][1] * H[0][1];
+        if (!(det > 0.0) || !isfinite(px) || !isfinite(py)) {
+            rejected_++;
+            return false;
+        }
+
+        t.fix.x = px;
+        t.fix.y = py;
+        t.fix.sigma = sqrt((H[0][0] + H[1][1]) / det);
+        t.fix.chi2 = used > 2 ? chi2 / (used - 2) : chi2;
+        t.fix.sensors = (uint8_t)n;
+        t.fix.timeMs = timeMs;
+        t.info[0][0] = H[0][0];
+        t.info[0][1] = t.info[1][0] = H[0][1];
+        t.info[1][1] = H[1][1];
+        t.hasFix = true;
+        return true;
+    }
+};
+
+#endif // LOCALIZER_H
@@ -0,0 +1,227 @@
+/*
+ * ESP-GlassHole — Prometheus Text Exposition
+ *
+ * Renders collector state in the Prometheus text format (version 0.0.4).
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "event_store.h"
+#include "localizer.h"
+#include "sensor_port.h"
+
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::string& out) : out_(out) {}
+
+    void header(const char* name, const char* type, const char* help) {
+        out_ += "# HELP ";
+        out_ += name;
+        out_ += ' ';
+        out_ += help;
+        out_ += "\n# TYPE ";
+        out_ += name;
+        out_ += ' ';
+        out_ += type;
+        out_ += '\n';
+    }
+
+    void value(const char* name, double v) {
+        out_ += name;
+        appendNumber(v);
+    }
+
+    void value(const char* name, const char* label, const std::string& labelValue, double v) {
+        out_ += name;
+        out_ += '{';
+        out_ += label;
+        out_ += "=\"";
+        appendEscaped(labelValue);
+        out_ += "\"}";
+        appendNumber(v);
+    }
+
+    // Two-label sample, e.g. {sensor="a",phase="scanStart"}
+    void value(const char* name, const char* label1, const std::string& value1,
+               const char* label2, const std::string& value2, double v) {
+        out_ += name;
+        out_ += '{';
+        out_ += label1;
+        out_ += "=\"";
+        appendEscaped(value1);
+        out_ += "\",";
+        out_ += label2;
+        out_ += "=\"";
+        appendEscaped(value2);
+        out_ += "\"}";
+        appendNumber(v);
+    }
+
+private:
+    std::string& out_;
+
+    void appendNumber(double v) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %.15g\n", v);
+        out_ += buf;
+    }
+
+    void appendEscaped(const std::string& s) {
+        for (char c : s) {
+            if (c == '\\' || c == '"') out_ += '\\';
+            if (c == '\n') { out_ += "\\n"; continue; }
+            out_ += c;
+        }
+    }
+};
+
+// Per-sensor counter/gauge: one HELP/TYPE block, one line per port
+template <typename Getter>
+void writeSensorMetric(MetricsWriter& w, const std::vector<SensorPort>& ports,
+                       const char* name, const char* type, const char* help,
+                       Getter get) {
+    w.header(name, type, help);
+    for (const SensorPort& p : ports) {
+        w.value(name, "sensor", p.name, (double)get(p));
+    }
+}
+
+inline void renderMetrics(std::string& out, const std::vector<SensorPort>& ports,
+                          const EventStore& store, const Localizer& localizer,
+                          uint64_t nowMs) {
+    MetricsWriter w(out);
+
+    writeSensorMetric(w, ports, "glasshole_sensor_up", "gauge",
+        "Whether the serial port is open",
+        [](const SensorPort& p) { return p.connected() ? 1 : 0; });
+    writeSensorMetric(w, ports, "glasshole_sensor_bytes_total", "counter",
+        "Bytes read from the serial port",
+        [](const SensorPort& p) { return p.stats.bytes; });
+    writeSensorMetric(w, ports, "glasshole_sensor_lines_total", "counter",
+        "Complete lines received",
+        [](const SensorPort& p) { return p.stats.lines; });
+    writeSensorMetric(w, ports, "glasshole_sensor_parse_errors_total", "counter",
+        "Lines that were not valid sensor JSON",
+        [](const SensorPort& p) { return p.stats.parseErrors; });
+    writeSensorMetric(w, ports, "glasshole_sensor_non_json_lines_total", "counter",
+        "Plain-text lines (startup banner, ROM boot log), ignored",
+        [](const SensorPort& p) { return p.stats.nonJsonLines; });
+    writeSensorMetric(w, ports, "glasshole_sensor_line_overflows_total", "counter",
+        "Lines dropped for exceeding the line buffer",
+        [](const SensorPort& p) { return p.buffer.overflows; });
+    writeSensorMetric(w, ports, "glasshole_sensor_detections_total", "counter",
+        "Detection messages received",
+        [](const SensorPort& p) { return p.stats.detections; });
+    writeSensorMetric(w, ports, "glasshole_sensor_wifi_detections_total", "counter",
+        "Detection messages from the Wi-Fi sniffer (not used for localization)",
+        [](const SensorPort& p) { return p.stats.wifiDetections; });
+    writeSensorMetric(w, ports, "glasshole_sensor_heartbeats_total", "counter",
+        "Heartbeat messages received",
+        [](const SensorPort& p) { return p.stats.heartbeats; });
+    writeSensorMetric(w, ports, "glasshole_sensor_boots_total", "counter",
+        "Boot messages received (sensor resets)",
+        [](const SensorPort& p) { return p.stats.boots; });
+    writeSensorMetric(w, ports, "glasshole_sensor_reconnects_total", "counter",
+        "Times the serial port was reopened",
+        [](const SensorPort& p) { return p.stats.reconnects; });
+    writeSensorMetric(w, ports, "glasshole_sensor_uptime_seconds", "gauge",
+        "Uptime reported by the sensor",
+        [](const SensorPort& p) { return p.uptime; });
+    writeSensorMetric(w, ports, "glasshole_sensor_free_heap_bytes", "gauge",
+        "Free heap reported by the sensor",
+        [](const SensorPort& p) { return p.freeHeap; });
+    writeSensorMetric(w, ports, "glasshole_sensor_reported_detections", "gauge",
+        "totalDetections from the latest sensor status",
+        [](const SensorPort& p) { return p.totalDetections; });
+    writeSensorMetric(w, ports, "glasshole_sensor_last_message_age_seconds", "gauge",
+        "Seconds since the last valid line",
+        [nowMs](const SensorPort& p) {
+            return p.lastMessageMs ? (double)(nowMs - p.lastMessageMs) / 1000.0 : -1.0;
+        });
+
+    // Boot phases from each sensor's last boot message, labelled with the
+    // PlatformIO env so time-to-first-scan can be compared per board
+    w.header("glasshole_sensor_boot_phase_ms", "gauge",
+             "Milliseconds from app start to each boot phase");
+    for (const SensorPort& p : ports) {
+        if (p.env.empty()) continue;
+        for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+            if (p.bootMs[i] < 0) continue;
+            w.value("glasshole_sensor_boot_phase_ms", "sensor", p.name,
+                    "phase", BOOT_PHASE_NAMES[i], p.bootMs[i]);
+        }
+    }
+    w.header("glasshole_sensor_info", "gauge", "Firmware build of each sensor");
+    for (const SensorPort& p : ports) {
+        if (p.env.empty()) continue;
+        w.value("glasshole_sensor_info", "sensor", p.name, "env", p.env, 1);
+    }
+
+    // Devices currently tracked, broken down by tier
+    size_t perTier[3] = {0, 0, 0};
+    size_t multiSensor = 0;
+    for (const auto& kv : store.devices()) {
+        const DeviceRecord& d = kv.second;
+        if (d.tier < 3) perTier[d.tier]++;
+        if (d.sensorMask & (d.sensorMask - 1)) multiSensor++;
+    }
+
+    static const char* TIER_NAMES[3] = { "high", "medium", "low" };
+    w.header("glasshole_devices", "gauge", "Devices seen within the expiry window");
+    for (int t = 0; t < 3; t++) {
+        w.value("glasshole_devices", "tier", TIER_NAMES[t], (double)perTier[t]);
+    }
+
+    w.header("glasshole_devices_multi_sensor", "gauge",
+             "Devices currently heard by more than one sensor");
+    w.value("glasshole_devices_multi_sensor", (double)multiSensor);
+
+    w.header("glasshole_events_total", "counter", "Detections merged into the store");
+    w.value("glasshole_events_total", (double)store.totalEvents());
+
+    w.header("glasshole_events_reordered_total", "counter",
+             "Detections that arrived out of time order");
+    w.value("glasshole_events_reordered_total", (double)store.reordered());
+
+    w.header("glasshole_devices_expired_total", "counter", "Devices dropped after going idle");
+    w.value("glasshole_devices_expired_total", (double)store.expiredDevices());
+
+    if (!localizer.enabled()) return;
+
+    // Path-loss models, placed sensors only
+    w.header("glasshole_sensor_path_loss_tx_power_dbm", "gauge",
+             "Fitted RSSI at 1 m for each placed sensor");
+    for (size_t i = 0; i < ports.size() && i < localizer.sites.size(); i++) {
+        if (!localizer.sites[i].placed) continue;
+        w.value("glasshole_sensor_path_loss_tx_power_dbm", "sensor", ports[i].name,
+                localizer.sites[i].model.txPower);
+    }
+    w.header("glasshole_sensor_path_loss_exponent", "gauge",
+             "Fitted path-loss exponent for each placed sensor");
+    for (size_t i = 0; i < ports.size() && i < localizer.sites.size(); i++) {
+        if (!localizer.sites[i].placed) continue;
+        w.value("glasshole_sensor_path_loss_exponent", "sensor", ports[i].name,
+                localizer.sites[i].model.exponent);
+    }
+
+    w.header("glasshole_localized_devices", "gauge", "Devices with a position track");
+    w.value("glasshole_localized_devices", (double)localizer.trackCount());
+
+    w.header("glasshole_localization_updates_total", "counter", "Position fixes produced");
+    w.value("glasshole_localization_updates_total", (double)localizer.updates());
+
+    w.header("glasshole_localization_rejected_total", "counter",
+             "Solves dropped for degenerate geometry");
+    w.value("glasshole_localization_rejected_total", (double)localizer.rejected());
+
+    w.header("glasshole_localization_calibrations_total", "counter",
+             "Anchor samples used to fit path-loss models");
+    w.value("glasshole_localization_calibrations_total", (double)localizer.calibrations());
+}
+
+#endif // METRICS_H
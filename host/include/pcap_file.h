@@ -0,0 +1,279 @@
+/*
+ * ESP-GlassHole — Capture File Reader
+ *
+ * Reads 802.11 frames from pcap and pcapng files (tcpdump, Wireshark,
+ * airodump-ng) for replay through the firmware's Wi-Fi parser. Supports
+ * raw 802.11 and radiotap link types; radiotap supplies the signal
+ * strength, channel and FCS flag the ESP32 gets from rx_ctrl.
+ */
+
+#ifndef PCAP_FILE_H
+#define PCAP_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define PCAP_LINKTYPE_IEEE802_11           105
+#define PCAP_LINKTYPE_IEEE802_11_RADIOTAP  127
+
+#define PCAP_NO_SIGNAL   -1000   // Frame carried no signal strength
+
+// One 802.11 frame with radiotap already stripped
+struct CapturedFrame {
+    uint64_t       timeUs;
+    const uint8_t* data;
+    size_t         len;        // FCS removed
+    int            rssi;       // dBm, or PCAP_NO_SIGNAL
+    uint8_t        channel;    // 0 if unknown
+};
+
+struct PcapFileStats {
+    uint32_t records;
+    uint32_t frames;           // Delivered as CapturedFrame
+    uint32_t unsupported;      // Other link types
+    uint32_t badFcs;           // Radiotap flagged a failed FCS
+    uint32_t malformed;        // Truncated radiotap or record
+};
+
+// ============================================================
+// Radiotap
+// ============================================================
+
+#define RADIOTAP_FLAGS_FCS      0x10
+#define RADIOTAP_FLAGS_BAD_FCS  0x40
+
+inline uint8_t channelFromMHz(uint32_t mhz) {
+    if (mhz == 2484) return 14;
+    if (mhz >= 2412 && mhz <= 2472) return (uint8_t)((mhz - 2407) / 5);
+    if (mhz >= 5000 && mhz <= 5900) return (uint8_t)((mhz - 5000) / 5);
+    return 0;
+}
+
+// Strips a radiotap header. Reads the fields of the first presence word
+// up to antenna signal (TSFT, flags, rate, channel, FHSS, dBm signal);
+// later fields are not needed.
+inline bool parseRadiotap(const uint8_t* buf, size_t len, CapturedFrame& out, uint8_t& flags) {
+    if (len < 8 || buf[0] != 0) return false;
+    size_t hdrLen = buf[2] | (buf[3] << 8);
+    if (hdrLen < 8 || hdrLen > len) return false;
+
+    uint32_t present = buf[4] | (buf[5] << 8) | (buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    size_t pos = 8;
+    for (uint32_t word = present; word & (1u << 31); pos += 4) {
+        if (pos + 4 > hdrLen) return false;
+        word = (uint32_t)buf[pos + 3] << 24;
+    }
+
+    static const uint8_t ALIGN[6] = { 8, 1, 1, 2, 1, 1 };
+    static const uint8_t SIZE[6]  = { 8, 1, 1, 4, 2, 1 };
+    flags = 0;
+    out.rssi = PCAP_NO_SIGNAL;
+    out.channel = 0;
+    for (int bit = 0; bit < 6; bit++) {
+        if (!(present & (1u << bit))) continue;
+        pos = (pos + ALIGN[bit] - 1) & ~(size_t)(ALIGN[bit] - 1);
+        if (pos + SIZE[bit] > hdrLen) return false;
+        const uint8_t* f = buf + pos;
+        if (bit == 1) flags = f[0];
+        if (bit == 3) out.channel = channelFromMHz(f[0] | (f[1] << 8));
+        if (bit == 5) out.rssi = (int8_t)f[0];
+        pos += SIZE[bit];
+    }
+
+    out.data = buf + hdrLen;
+    out.len = len - hdrLen;
+    return true;
+}
+
+// ============================================================
+// File Reader
+// ============================================================
+
+class PcapFile {
+public:
+    // Loads the whole file; captures are replayed many times over
+    bool open(const char* path) {
+        FILE* f = fopen(path, "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buf_.resize(len > 0 ? (size_t)len : 0);
+        bool ok = len > 0 && fread(buf_.data(), 1, buf_.size(), f) == buf_.size();
+        fclose(f);
+        if (!ok || buf_.size() < 24) return false;
+
+        pos_ = 0;
+        stats_ = PcapFileStats();
+        uint32_t magic = le32(0);
+        if (magic == 0xA1B2C3D4 || magic == 0xA1B23C4D) {
+            swap_ = false;
+        } else if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) {
+            swap_ = true;
+            magic = swap32(magic);
+        } else if (magic == 0x0A0D0D0A) {
+            ng_ = true;
+            return true;   // Section header is read as the first block
+        } else {
+            return false;
+        }
+        ng_ = false;
+        nanos_ = magic == 0xA1B23C4D;
+        linkType_ = u32(20) & 0xFFFF;
+        pos_ = 24;
+        return true;
+    }
+
+    bool isPcapng() const { return ng_; }
+
+    // Next 802.11 frame; false at end of file
+    bool next(CapturedFrame& out) {
+        while (ng_ ? nextBlock(out) : nextRecord(out)) {
+            if (deliver(out)) return true;
+        }
+        return false;
+    }
+
+    const PcapFileStats& stats() const { return stats_; }
+
+private:
+    struct Interface {
+        uint16_t linkType;
+        uint64_t ticksPerSec;
+    };
+
+    uint32_t le32(size_t at) const {
+        return buf_[at] | (buf_[at + 1] << 8) | (buf_[at + 2] << 16) | ((uint32_t)buf_[at + 3] << 24);
+    }
+    static uint32_t swap32(uint32_t v) { return __builtin_bswap32(v); }
+    uint32_t u32(size_t at) const { return swap_ ? swap32(le32(at)) : le32(at); }
+    uint16_t u16(size_t at) const {
+        uint16_t v = buf_[at] | (buf_[at + 1] << 8);
+        return swap_ ? __builtin_bswap16(v) : v;
+    }
+
+    // --- Classic pcap ---
+
+    bool nextRecord(CapturedFrame& out) {
+        if (pos_ + 16 > buf_.size()) return false;
+        uint32_t sec = u32(pos_);
+        uint32_t frac = u32(pos_ + 4);
+        uint32_t capLen = u32(pos_ + 8);
+        if (pos_ + 16 + (uint64_t)capLen > buf_.size()) {
+            stats_.malformed++;
+            return false;
+        }
+        stats_.records++;
+        out.timeUs = (uint64_t)sec * 1000000 + (nanos_ ? frac / 1000 : frac);
+        out.data = &buf_[pos_ + 16];
+        out.len = capLen;
+        recordLinkType_ = linkType_;
+        pos_ += 16 + capLen;
+        return true;
+    }
+
+    // --- pcapng ---
+
+    bool nextBlock(CapturedFrame& out) {
+        while (pos_ + 12 <= buf_.size()) {
+            uint32_t type = le32(pos_);
+            if (type == 0x0A0D0D0A) {
+                // Section header: byte order, then a fresh interface list
+                uint32_t bom = le32(pos_ + 8);
+                if (bom == 0x1A2B3C4D) swap_ = false;
+                else if (bom == 0x4D3C2B1A) swap_ = true;
+                else return false;
+                interfaces_.clear();
+            }
+            uint32_t blockLen = u32(pos_ + 4);
+            if (blockLen < 12 || pos_ + blockLen > buf_.size()) {
+                stats_.malformed++;
+                return false;
+            }
+            size_t block = pos_;
+            pos_ += blockLen;
+            type = u32(block);
+
+            if (type == 1 && blockLen >= 20) {
+                interfaces_.push_back(readInterface(block, blockLen));
+            } else if (type == 6 && blockLen >= 32) {
+                uint32_t ifIndex = u32(block + 8);
+                uint64_t ts = ((uint64_t)u32(block + 12) << 32) | u32(block + 16);
+                uint32_t capLen = u32(block + 20);
+                if (ifIndex >= interfaces_.size() || 32 + (uint64_t)capLen > blockLen) {
+                    stats_.malformed++;
+                    continue;
+                }
+                stats_.records++;
+                const Interface& itf = interfaces_[ifIndex];
+                out.timeUs = itf.ticksPerSec == 1000000 ? ts
+                           : (uint64_t)((double)ts * 1e6 / itf.ticksPerSec);
+                out.data = &buf_[block + 28];
+                out.len = capLen;
+                recordLinkType_ = itf.linkType;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Interface description: link type and if_tsresol (default microseconds)
+    Interface readInterface(size_t block, uint32_t blockLen) const {
+        Interface itf = { u16(block + 8), 1000000 };
+        size_t opt = block + 16;
+        size_t end = block + blockLen - 4;
+        while (opt + 4 <= end) {
+            uint16_t code = u16(opt);
+            uint16_t len = u16(opt + 2);
+            if (code == 0 || opt + 4 + len > end) break;
+            if (code == 9 && len >= 1) {
+                uint8_t res = buf_[opt + 4];
+                uint64_t ticks = 1;
+                for (int i = 0; i < (res & 0x7F) && ticks < (1ull << 60); i++) {
+                    ticks *= (res & 0x80) ? 2 : 10;
+                }
+                itf.ticksPerSec = ticks;
+            }
+            opt += 4 + ((len + 3) & ~3u);
+        }
+        return itf;
+    }
+
+    // Strip the link-layer header and FCS
+    bool deliver(CapturedFrame& out) {
+        uint8_t flags = 0;
+        if (recordLinkType_ == PCAP_LINKTYPE_IEEE802_11_RADIOTAP) {
+            if (!parseRadiotap(out.data, out.len, out, flags)) {
+                stats_.malformed++;
+                return false;
+            }
+            if (flags & RADIOTAP_FLAGS_BAD_FCS) {
+                stats_.badFcs++;
+                return false;
+            }
+            if (flags & RADIOTAP_FLAGS_FCS) out.len = out.len >= 4 ? out.len - 4 : 0;
+        } else if (recordLinkType_ == PCAP_LINKTYPE_IEEE802_11) {
+            out.rssi = PCAP_NO_SIGNAL;
+            out.channel = 0;
+        } else {
+            stats_.unsupported++;
+            return false;
+        }
+        stats_.frames++;
+        return true;
+    }
+
+    std::vector<uint8_t>   buf_;
+    size_t                 pos_ = 0;
+    bool                   ng_ = false;
+    bool                   swap_ = false;
+    bool                   nanos_ = false;
+    uint16_t               linkType_ = 0;         // Classic pcap: one per file
+    uint16_t               recordLinkType_ = 0;
+    std::vector<Interface> interfaces_;
+    PcapFileStats          stats_ = {};
+};
+
+#endif // PCAP_FILE_H
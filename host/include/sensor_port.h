@@ -0,0 +1,97 @@
+/*
+ * ESP-GlassHole — Sensor Serial Port
+ *
+ * One USB serial (or pty) connection to an ESP-GlassHole unit, with its
+ * line buffer, clock alignment and per-port counters.
+ */
+
+#ifndef SENSOR_PORT_H
+#define SENSOR_PORT_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+
+#include "event_store.h"
+#include "serial_stream.h"
+
+#define SENSOR_BAUD B115200   // Matches SERIAL_BAUD in firmware config.h
+
+struct SensorStats {
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+    uint64_t parseErrors = 0;
+    uint64_t nonJsonLines = 0;   // Banner and ROM boot log text
+    uint64_t detections = 0;
+    uint64_t wifiDetections = 0;  // Included in detections, never localized
+    uint64_t statuses = 0;
+    uint64_t heartbeats = 0;
+    uint64_t boots = 0;
+    uint64_t reconnects = 0;
+};
+
+struct SensorPort {
+    std::string name;       // Label used in metrics and output
+    std::string nameJson;   // name escaped for JSON output
+    std::string path;
+    int         fd = -1;
+    uint64_t    nextRetryMs = 0;
+    bool        everConnected = false;
+    LineBuffer  buffer;
+    SensorClock clock;
+    SensorStats stats;
+
+    // Latest values reported by the unit itself
+    std::string board;
+    std::string env;
+    std::string version;
+    int32_t     bootMs[BOOT_PHASE_COUNT] = { -1, -1, -1, -1, -1 };   // Latest boot phases
+    uint32_t    uptime = 0;
+    uint32_t    freeHeap = 0;
+    uint32_t    totalScans = 0;
+    uint32_t    totalDetections = 0;
+    uint32_t    trackedDevices = 0;
+    uint64_t    lastMessageMs = 0;
+
+    bool connected() const { return fd >= 0; }
+};
+
+// Open the port non-blocking in raw 8N1 mode. Anything that is not a tty
+// (FIFOs, plain files) is accepted as-is.
+inline int openSensorPort(SensorPort& port) {
+    int fd = open(port.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -errno;
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, SENSOR_BAUD);
+        cfsetospeed(&tio, SENSOR_BAUD);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 1;    // With VMIN=0 an empty tty reads as EOF
+        tio.c_cc[VTIME] = 0;
+        if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+            int err = errno;
+            close(fd);
+            return -err;
+        }
+        tcflush(fd, TCIFLUSH);
+    }
+
+    port.fd = fd;
+    port.buffer.reset();
+    port.clock.reset();
+    return 0;
+}
+
+inline void closeSensorPort(SensorPort& port) {
+    if (port.fd >= 0) close(port.fd);
+    port.fd = -1;
+    port.buffer.reset();
+    port.clock.reset();
+}
+
+#endif // SENSOR_PORT_H
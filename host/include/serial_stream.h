@@ -0,0 +1,411 @@
+/*
+ * ESP-GlassHole — Incremental Serial Stream Parser
+ *
+ * The firmware writes one flat JSON object per line. Bytes are read
+ * straight into a fixed per-port buffer, complete lines are handed out
+ * as string_views into that buffer, and JSON fields are scanned in place.
+ * Nothing is copied or allocated until an event is committed to the store.
+ */
+
+#ifndef SERIAL_STREAM_H
+#define SERIAL_STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+
+#include "collector_config.h"
+
+// ============================================================
+// Line Buffer
+// ============================================================
+
+struct LineBuffer {
+    char     data[COLLECTOR_LINE_BUFFER];
+    size_t   len = 0;
+    bool     discarding = false;   // Dropping the tail of an oversized line
+    uint32_t overflows = 0;
+
+    char*  writePtr()   { return data + len; }
+    size_t writeSpace() { return sizeof(data) - len; }
+
+    void reset() {
+        len = 0;
+        discarding = false;
+    }
+
+    // Account for `n` bytes just read into writePtr() and invoke
+    // onLine(std::string_view) for every complete line, without the
+    // trailing "\r\n". Views are only valid for the duration of the call.
+    template <typename F>
+    void commit(size_t n, F&& onLine) {
+        size_t scanFrom = len;
+        len += n;
+
+        size_t start = 0;
+        while (true) {
+            const char* nl = (const char*)memchr(data + scanFrom, '\n', len - scanFrom);
+            if (!nl) break;
+            size_t end = nl - data;
+            if (discarding) {
+                discarding = false;
+            } else {
+                size_t lineEnd = end;
+                if (lineEnd > start && data[lineEnd - 1] == '\r') lineEnd--;
+                if (lineEnd > start) onLine(std::string_view(data + start, lineEnd - start));
+            }
+            start = end + 1;
+            scanFrom = start;
+        }
+
+        // Keep the partial line at the front of the buffer
+        if (start > 0) {
+            memmove(data, data + start, len - start);
+            len -= start;
+        }
+
+        // Buffer full with no newline — drop this line entirely
+        if (len == sizeof(data)) {
+            if (!discarding) overflows++;
+            len = 0;
+            discarding = true;
+        }
+    }
+};
+
+// ============================================================
+// Flat JSON Scanner
+// ============================================================
+// Handles exactly what the firmware emits: a single object whose values
+// are strings, numbers, booleans or null. Nested values are skipped.
+// String views are raw (escape sequences are not decoded).
+
+enum JsonKind : uint8_t {
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_BOOL,
+    JSON_NULL,
+    JSON_OTHER
+};
+
+struct JsonField {
+    std::string_view key;
+    std::string_view value;
+    JsonKind         kind;
+};
+
+class JsonScanner {
+public:
+    explicit JsonScanner(std::string_view text) : s_(text), pos_(0), ok_(true) {
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == '{') pos_++;
+        else ok_ = false;
+    }
+
+    bool ok() const { return ok_; }
+
+    // Returns false at the end of the object or on malformed input
+    // (check ok() to tell the two apart).
+    bool next(JsonField& field) {
+        if (!ok_) return false;
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == ',') { pos_++; skipSpace(); }
+        if (pos_ >= s_.size()) return fail();
+        if (s_[pos_] == '}') { pos_++; return false; }
+
+        if (!readString(field.key)) return fail();
+        skipSpace();
+        if (pos_ >= s_.size() || s_[pos_] != ':') return fail();
+        pos_++;
+        skipSpace();
+        if (pos_ >= s_.size()) return fail();
+
+        char c = s_[pos_];
+        if (c == '"') {
+            field.kind = JSON_STRING;
+            return readString(field.value) || fail();
+        }
+        if (c == '{' || c == '[') {
+            field.kind = JSON_OTHER;
+            return skipNested(field.value) || fail();
+        }
+
+        size_t start = pos_;
+        while (pos_ < s_.size() && s_[pos_] != ',' && s_[pos_] != '}' &&
+               s_[pos_] != ' ' && s_[pos_] != '\t') {
+            pos_++;
+        }
+        field.value = s_.substr(start, pos_ - start);
+        if (field.value == "true" || field.value == "false") field.kind = JSON_BOOL;
+        else if (field.value == "null")                       field.kind = JSON_NULL;
+        else if (!field.value.empty())                        field.kind = JSON_NUMBER;
+        else return fail();
+        return true;
+    }
+
+private:
+    std::string_view s_;
+    size_t           pos_;
+    bool             ok_;
+
+    bool fail() {
+        ok_ = false;
+        return false;
+    }
+
+    void skipSpace() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t')) pos_++;
+    }
+
+    bool readString(std::string_view& out) {
+        if (pos_ >= s_.size() || s_[pos_] != '"') return false;
+        size_t start = ++pos_;
+        while (pos_ < s_.size()) {
+            char c = s_[pos_];
+            if (c == '\\') { pos_ += 2; continue; }
+            if (c == '"') {
+                out = s_.substr(start, pos_ - start);
+                pos_++;
+                return true;
+            }
+            pos_++;
+        }
+        return false;
+    }
+
+    bool skipNested(std::string_view& out) {
+        size_t start = pos_;
+        int depth = 0;
+        bool inString = false;
+        while (pos_ < s_.size()) {
+            char c = s_[pos_++];
+            if (inString) {
+                if (c == '\\') pos_++;
+                else if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    out = s_.substr(start, pos_ - start);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// ============================================================
+// Value Helpers
+// ============================================================
+
+// Decimal integer, fraction truncated. False for anything else, including
+// values beyond int64 range (garbled lines can carry long digit runs).
+inline bool parseInt(std::string_view s, int64_t& out) {
+    if (s.empty()) return false;
+    size_t i = 0;
+    bool neg = false;
+    if (s[0] == '-') { neg = true; i = 1; }
+    if (i >= s.size()) return false;
+    int64_t v = 0;
+    for (; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '.') break;   // Truncate fractional values
+        if (c < '0' || c > '9') return false;
+        if (v > (INT64_MAX - (c - '0')) / 10) return false;
+        v = v * 10 + (c - '0');
+    }
+    out = neg ? -v : v;
+    return true;
+}
+
+inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "7c:2a:9e:01:02:03" -> 6 bytes
+inline bool parseMac(std::string_view s, uint8_t mac[6]) {
+    if (s.size() != 17) return false;
+    for (int i = 0; i < 6; i++) {
+        int hi = hexNibble(s[i * 3]);
+        int lo = hexNibble(s[i * 3 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        if (i < 5 && s[i * 3 + 2] != ':') return false;
+        mac[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// "0x01AB" -> 0x01AB
+inline bool parseHex16(std::string_view s, uint16_t& out) {
+    if (s.size() < 3 || s[0] != '0' || (s[1] != 'x' && s[1] != 'X')) return false;
+    uint32_t v = 0;
+    for (size_t i = 2; i < s.size(); i++) {
+        int n = hexNibble(s[i]);
+        if (n < 0) return false;
+        v = (v << 4) | n;
+    }
+    if (v > 0xFFFF) return false;
+    out = (uint16_t)v;
+    return true;
+}
+
+// Append s as the body of a JSON string: quotes, backslashes and control
+// characters escaped
+inline void appendJsonEscaped(std::string& out, std::string_view s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)c);
+            out += esc;
+        } else {
+            out += c;
+        }
+    }
+}
+
+// ============================================================
+// Sensor Messages
+// ============================================================
+
+#define BOOT_PHASE_COUNT 5   // Entries of BOOT_PHASE_NAMES
+
+enum SensorMessageType : uint8_t {
+    MSG_UNKNOWN,
+    MSG_BOOT,
+    MSG_STATUS,
+    MSG_HEARTBEAT,
+    MSG_DETECTION,
+    MSG_REPLY          // Serial command output (journal queries, errors)
+};
+
+// Decoded view of one firmware line. String members point into the
+// line buffer and must be copied before the line callback returns.
+struct SensorMessage {
+    SensorMessageType type = MSG_UNKNOWN;
+
+    // detection
+    uint8_t          mac[6] = {0};
+    bool             hasMac = false;
+    int              rssi = 0;
+    bool             hasRssi = false;
+    uint8_t          tier = 0;
+    bool             hasCamera = false;
+    uint16_t         companyId = 0;
+    bool             hasCompanyId = false;
+    std::string_view company;
+    std::string_view product;
+    uint32_t         ts = 0;
+    bool             hasTs = false;
+    bool             wifi = false;    // "source":"wifi"; BLE when absent
+
+    // boot / status / heartbeat
+    std::string_view board;
+    std::string_view env;
+    std::string_view version;
+    int32_t          bootMs[BOOT_PHASE_COUNT] = { -1, -1, -1, -1, -1 };   // See BOOT_PHASE_NAMES
+    uint32_t         uptime = 0;
+    uint32_t         freeHeap = 0;
+    uint32_t         totalScans = 0;
+    uint32_t         totalDetections = 0;
+    uint32_t         trackedDevices = 0;
+};
+
+// Phases of the boot message's "bootMs" object, in order
+static const char* const BOOT_PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "setup", "bleReady", "scanStart", "firstAdvert", "firstDetection"
+};
+
+inline void parseBootPhases(std::string_view object, SensorMessage& msg) {
+    JsonScanner scanner(object);
+    JsonField f;
+    int64_t v;
+    while (scanner.next(f)) {
+        for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+            if (f.key == BOOT_PHASE_NAMES[i] && parseInt(f.value, v)) msg.bootMs[i] = (int32_t)v;
+        }
+    }
+}
+
+// False for anything but a complete object of a known type. A numeric
+// field that does not parse means the line was garbled in transit, so the
+// whole line is rejected rather than read with that field missing.
+inline bool parseSensorLine(std::string_view line, SensorMessage& msg) {
+    JsonScanner scanner(line);
+    JsonField f;
+    int64_t v;
+
+    while (scanner.next(f)) {
+        const std::string_view& k = f.key;
+        if (k == "type") {
+            if      (f.value == "detection") msg.type = MSG_DETECTION;
+            else if (f.value == "status")    msg.type = MSG_STATUS;
+            else if (f.value == "heartbeat") msg.type = MSG_HEARTBEAT;
+            else if (f.value == "boot")      msg.type = MSG_BOOT;
+            else if (f.value == "journal" || f.value == "journal_end" ||
+                     f.value == "journal_stats" || f.value == "error") msg.type = MSG_REPLY;
+        } else if (k == "mac") {
+            msg.hasMac = parseMac(f.value, msg.mac);
+        } else if (k == "rssi") {
+            if (!parseInt(f.value, v)) return false;
+            msg.rssi = (int)v;
+            msg.hasRssi = true;
+        } else if (k == "tier") {
+            if (!parseInt(f.value, v)) return false;
+            msg.tier = (uint8_t)v;
+        } else if (k == "hasCamera") {
+            msg.hasCamera = (f.value == "true");
+        } else if (k == "companyId") {
+            msg.hasCompanyId = parseHex16(f.value, msg.companyId);
+        } else if (k == "company") {
+            msg.company = f.value;
+        } else if (k == "product") {
+            msg.product = f.value;
+        } else if (k == "source") {
+            msg.wifi = (f.value == "wifi");
+        } else if (k == "ts") {
+            if (!parseInt(f.value, v)) return false;
+            msg.ts = (uint32_t)v;
+            msg.hasTs = true;
+        } else if (k == "board") {
+            msg.board = f.value;
+        } else if (k == "env") {
+            msg.env = f.value;
+        } else if (k == "version") {
+            msg.version = f.value;
+        } else if (k == "bootMs") {
+            if (f.kind == JSON_OTHER) parseBootPhases(f.value, msg);
+        } else if (k == "uptime") {
+            if (!parseInt(f.value, v)) return false;
+            msg.uptime = (uint32_t)v;
+        } else if (k == "freeHeap") {
+            if (!parseInt(f.value, v)) return false;
+            msg.freeHeap = (uint32_t)v;
+        } else if (k == "totalScans") {
+            if (!parseInt(f.value, v)) return false;
+            msg.totalScans = (uint32_t)v;
+        } else if (k == "totalDetections") {
+            if (!parseInt(f.value, v)) return false;
+            msg.totalDetections = (uint32_t)v;
+        } else if (k == "trackedDevices") {
+            if (!parseInt(f.value, v)) return false;
+            msg.trackedDevices = (uint32_t)v;
+        }
+    }
+
+    if (!scanner.ok() || msg.type == MSG_UNKNOWN) return false;
+    if (msg.type == MSG_DETECTION && (!msg.hasMac || !msg.hasRssi)) return false;
+    return true;
+}
+
+#endif // SERIAL_STREAM_H
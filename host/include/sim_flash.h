@@ -0,0 +1,162 @@
+/*
+ * ESP-GlassHole — Simulated NOR Flash
+ *
+ * In-memory flash backend for journal.h. Enforces NOR semantics (program
+ * only clears bits, erase sets a whole sector to 0xFF), counts every
+ * operation and estimates the time the same operations take on the
+ * ESP32's SPI flash. Can load and save raw partition images read with
+ * esptool, and can cut power after a given number of programmed bytes to
+ * exercise recovery.
+ */
+
+#ifndef SIM_FLASH_H
+#define SIM_FLASH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "journal.h"
+
+// ============================================================
+// Timing Model
+// ============================================================
+// Typical figures for the 4 MB QSPI parts on ESP32 modules (W25Q32 /
+// GD25Q32 class) plus esp_partition call overhead. Estimates only.
+
+#define SIM_FLASH_PAGE_SIZE         256
+#define SIM_FLASH_PROGRAM_FIRST_US  30.0     // tBP1: first byte of a page program
+#define SIM_FLASH_PROGRAM_BYTE_US   2.5      // tBPn: each further byte
+#define SIM_FLASH_PAGE_PROGRAM_US   400.0    // tPP: full 256-byte page
+#define SIM_FLASH_SECTOR_ERASE_US   45000.0  // tSE: 4 KiB sector
+#define SIM_FLASH_READ_MB_S         20.0     // 40 MHz QIO, cache bypassed
+#define SIM_FLASH_CALL_US           5.0      // Driver overhead per operation
+
+struct SimFlashStats {
+    uint64_t reads;
+    uint64_t readBytes;
+    uint64_t programs;        // write() calls
+    uint64_t pagePrograms;    // Page program commands issued
+    uint64_t programBytes;
+    uint64_t erases;
+    double   estimatedUs;     // Sum of modelled device time
+};
+
+class SimFlash {
+public:
+    explicit SimFlash(uint32_t size = 0) { resize(size); }
+
+    void resize(uint32_t size) {
+        size = size / JOURNAL_SECTOR_SIZE * JOURNAL_SECTOR_SIZE;
+        mem_.assign(size, 0xFF);
+        sectorErases_.assign(size / JOURNAL_SECTOR_SIZE, 0);
+        resetStats();
+    }
+
+    // Raw partition image (e.g. esptool.py read_flash). Trailing bytes
+    // past the last whole sector are ignored.
+    bool loadImage(const char* path) {
+        FILE* f = fopen(path, "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (len < JOURNAL_SECTOR_SIZE) {
+            fclose(f);
+            return false;
+        }
+        resize((uint32_t)len);
+        bool ok = fread(mem_.data(), 1, mem_.size(), f) == mem_.size();
+        fclose(f);
+        return ok;
+    }
+
+    bool saveImage(const char* path) const {
+        FILE* f = fopen(path, "wb");
+        if (!f) return false;
+        bool ok = fwrite(mem_.data(), 1, mem_.size(), f) == mem_.size();
+        return fclose(f) == 0 && ok;
+    }
+
+    // --- Backend interface (journal.h) ---
+
+    uint32_t size() const { return (uint32_t)mem_.size(); }
+
+    bool read(uint32_t offset, void* buf, size_t len) {
+        if (!inRange(offset, len)) return false;
+        memcpy(buf, &mem_[offset], len);
+        stats_.reads++;
+        stats_.readBytes += len;
+        stats_.estimatedUs += SIM_FLASH_CALL_US + len / SIM_FLASH_READ_MB_S;
+        return true;
+    }
+
+    bool write(uint32_t offset, const void* buf, size_t len) {
+        if (!inRange(offset, len) || powerCut_) return false;
+        const uint8_t* src = (const uint8_t*)buf;
+        stats_.programs++;
+        stats_.estimatedUs += SIM_FLASH_CALL_US;
+
+        // The driver splits writes at page boundaries
+        while (len > 0) {
+            size_t room = SIM_FLASH_PAGE_SIZE - offset % SIM_FLASH_PAGE_SIZE;
+            size_t n = len < room ? len : room;
+            for (size_t i = 0; i < n; i++) {
+                if (cutAfterBytes_ == 0) {
+                    powerCut_ = true;
+                    return false;
+                }
+                if (cutAfterBytes_ > 0) cutAfterBytes_--;
+                mem_[offset + i] &= src[i];   // NOR: program clears bits only
+            }
+            double us = SIM_FLASH_PROGRAM_FIRST_US + SIM_FLASH_PROGRAM_BYTE_US * (n - 1);
+            stats_.estimatedUs += us < SIM_FLASH_PAGE_PROGRAM_US ? us : SIM_FLASH_PAGE_PROGRAM_US;
+            stats_.pagePrograms++;
+            stats_.programBytes += n;
+            offset += n;
+            src += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool eraseSector(uint32_t offset) {
+        if (offset % JOURNAL_SECTOR_SIZE || !inRange(offset, JOURNAL_SECTOR_SIZE) || powerCut_) {
+            return false;
+        }
+        memset(&mem_[offset], 0xFF, JOURNAL_SECTOR_SIZE);
+        sectorErases_[offset / JOURNAL_SECTOR_SIZE]++;
+        stats_.erases++;
+        stats_.estimatedUs += SIM_FLASH_CALL_US + SIM_FLASH_SECTOR_ERASE_US;
+        return true;
+    }
+
+    // --- Instrumentation ---
+
+    const SimFlashStats& stats() const { return stats_; }
+    void resetStats() { stats_ = SimFlashStats(); }
+
+    const std::vector<uint32_t>& sectorErases() const { return sectorErases_; }
+
+    // Lose power after n more programmed bytes: the byte in flight and
+    // everything after it is never written. Negative disables.
+    void cutPowerAfter(int64_t n) {
+        cutAfterBytes_ = n;
+        powerCut_ = false;
+    }
+    bool powerCut() const { return powerCut_; }
+
+private:
+    bool inRange(uint32_t offset, size_t len) const {
+        return (uint64_t)offset + len <= mem_.size();
+    }
+
+    std::vector<uint8_t>  mem_;
+    std::vector<uint32_t> sectorErases_;
+    SimFlashStats         stats_ = {};
+    int64_t               cutAfterBytes_ = -1;
+    bool                  powerCut_ = false;
+};
+
+#endif // SIM_FLASH_H
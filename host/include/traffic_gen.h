@@ -0,0 +1,335 @@
+/*
+ * ESP-GlassHole — Synthetic BLE Crowd Traffic
+ *
+ * Generates advertisement payloads for a crowd of phones, earbuds, beacons
+ * and smart glasses: real company IDs and service UUIDs, rotating random
+ * addresses, and RSSI from a log-distance model over people scattered
+ * around the sensor. Adverts are raw AD structures (advert + scan response,
+ * as the ESP32 BLE stack merges them) and are parsed on access, so the
+ * detection pipeline sees the same work it does on the device.
+ *
+ * SyntheticAdvert implements the advertisement interface in detection.h.
+ */
+
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// ============================================================
+// Synthetic Advertisement
+// ============================================================
+
+#define AD_TYPE_UUID16_INCOMPLETE 0x02
+#define AD_TYPE_UUID16_COMPLETE   0x03
+#define AD_TYPE_NAME_SHORT        0x08
+#define AD_TYPE_NAME_COMPLETE     0x09
+#define AD_TYPE_MANUFACTURER      0xFF
+
+#define SYNTH_PAYLOAD_MAX         62      // 31-byte advert + 31-byte scan response
+
+struct SyntheticAdvert {
+    uint8_t  addr[6];
+    int8_t   rssiDbm;
+    uint8_t  payloadLen;
+    uint8_t  payload[SYNTH_PAYLOAD_MAX];
+    uint32_t timeMs;
+
+    int            rssi() const { return rssiDbm; }
+    const uint8_t* mac()  const { return addr; }
+
+    bool companyId(uint16_t& id) const {
+        const uint8_t* d;
+        uint8_t len;
+        if (!findAD(AD_TYPE_MANUFACTURER, d, len) || len < 2) return false;
+        id = d[0] | (d[1] << 8);
+        return true;
+    }
+
+    bool advertisesService16(uint16_t uuid) const {
+        for (uint8_t type = AD_TYPE_UUID16_INCOMPLETE; type <= AD_TYPE_UUID16_COMPLETE; type++) {
+            const uint8_t* d;
+            uint8_t len;
+            if (!findAD(type, d, len)) continue;
+            for (uint8_t i = 0; i + 1 < len; i += 2) {
+                if ((d[i] | (d[i + 1] << 8)) == uuid) return true;
+            }
+        }
+        return false;
+    }
+
+    bool name(const char*& str, size_t& len) const {
+        const uint8_t* d;
+        uint8_t n;
+        if (!findAD(AD_TYPE_NAME_COMPLETE, d, n) && !findAD(AD_TYPE_NAME_SHORT, d, n)) {
+            return false;
+        }
+        str = (const char*)d;
+        len = n;
+        return true;
+    }
+
+    // Walk the AD structures: [len][type][data...]
+    bool findAD(uint8_t type, const uint8_t*& data, uint8_t& len) const {
+        uint8_t i = 0;
+        while (i + 1 < payloadLen) {
+            uint8_t l = payload[i];
+            if (l == 0 || i + 1 + l > payloadLen) return false;
+            if (payload[i + 1] == type) {
+                data = payload + i + 2;
+                len = l - 1;
+                return true;
+            }
+            i += 1 + l;
+        }
+        return false;
+    }
+};
+
+// ============================================================
+// Device Profiles
+// ============================================================
+
+enum DeviceClass : uint8_t {
+    CLASS_PHONE,
+    CLASS_EARBUDS,
+    CLASS_BEACON,
+    CLASS_GLASSES,
+    CLASS_COUNT
+};
+
+static const char* const DEVICE_CLASS_NAMES[CLASS_COUNT] = {
+    "phone", "earbuds", "beacon", "glasses"
+};
+
+struct AdvertProfile {
+    DeviceClass cls;
+    uint8_t     share;          // Relative weight within its class
+    uint16_t    companyId;      // 0 = no manufacturer data
+    uint8_t     mfgLen;         // Bytes after the company ID
+    uint16_t    uuid16;         // 0 = no service list
+    const char* name;           // printf format with one %04X, or NULL
+    int8_t      txPower;        // RSSI at 1 m
+    bool        rotates;        // Resolvable private address
+};
+
+static const AdvertProfile ADVERT_PROFILES[] = {
+    // Phones
+    { CLASS_PHONE,   50, 0x004C, 20, 0x0000, NULL,             -59, true  },  // iPhone Nearby Info
+    { CLASS_PHONE,   20, 0x0075, 24, 0x0000, NULL,             -60, true  },  // Samsung
+    { CLASS_PHONE,   15, 0x0006, 27, 0x0000, NULL,             -62, true  },  // Microsoft CDP
+    { CLASS_PHONE,   15, 0x0000,  0, 0xFE2C, NULL,             -60, true  },  // Google Fast Pair
+    // Earbuds / headphones
+    { CLASS_EARBUDS, 45, 0x004C, 25, 0x0000, NULL,             -65, true  },  // AirPods
+    { CLASS_EARBUDS, 20, 0x0075, 16, 0x0000, "Galaxy Buds2 %04X", -66, true },
+    { CLASS_EARBUDS, 15, 0x012D, 12, 0x0000, "WH-1000XM5",     -62, false },  // Sony
+    { CLASS_EARBUDS, 10, 0x009E,  8, 0x0000, "Bose QC %04X",   -63, false },
+    { CLASS_EARBUDS, 10, 0x0057, 10, 0x0000, "JBL Tune %04X",  -64, false },  // Harman
+    // Beacons / trackers / wearables
+    { CLASS_BEACON,  35, 0x004C, 23, 0x0000, NULL,             -70, false },  // iBeacon
+    { CLASS_BEACON,  20, 0x0000,  0, 0xFEAA, NULL,             -68, false },  // Eddystone
+    { CLASS_BEACON,  25, 0x0000,  0, 0xFEED, NULL,             -72, true  },  // Tile
+    { CLASS_BEACON,  20, 0x038F, 14, 0x0000, "Mi Smart Band %04X", -66, false },
+    // Smart glasses
+    { CLASS_GLASSES, 50, 0x01AB, 12, 0x0000, NULL,             -60, true  },  // Ray-Ban Meta
+    { CLASS_GLASSES, 20, 0x058E, 16, 0xFD5F, "RB Meta %04X",   -60, true  },
+    { CLASS_GLASSES, 15, 0x03C2, 10, 0x0000, "Spectacles %04X", -62, true },
+    { CLASS_GLASSES, 15, 0x060C,  8, 0x0000, "Vuzix Blade %04X", -61, false },
+};
+
+static const int ADVERT_PROFILE_COUNT = sizeof(ADVERT_PROFILES) / sizeof(ADVERT_PROFILES[0]);
+
+// ============================================================
+// Generator
+// ============================================================
+
+struct TrafficConfig {
+    uint32_t advertsPerSecond = 5000;
+    double   classMix[CLASS_COUNT] = { 0.55, 0.25, 0.15, 0.05 };   // Share of adverts
+    double   advertIntervalMs = 200.0;    // Per device; sets crowd size
+    double   crowdRadiusM = 30.0;
+    double   pathLossExponent = 2.5;
+    double   rssiSigmaDb = 4.0;
+    uint32_t rotateMs = 15 * 60 * 1000;   // Private address lifetime
+    uint64_t seed = 1;
+};
+
+class TrafficGenerator {
+public:
+    explicit TrafficGenerator(const TrafficConfig& cfg) : cfg_(cfg), rng_(cfg.seed | 1) {
+        // Crowd size per class so each class produces its share of adverts
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            double rate = cfg_.advertsPerSecond * cfg_.classMix[c];
+            size_t n = (size_t)ceil(rate * cfg_.advertIntervalMs / 1000.0);
+            classStart_[c] = devices_.size();
+            for (size_t i = 0; i < n; i++) devices_.push_back(makeDevice((DeviceClass)c));
+            classCount_[c] = n;
+        }
+    }
+
+    size_t crowdSize() const { return devices_.size(); }
+
+    void next(SyntheticAdvert& adv) {
+        clockMs_ += 1000.0 / cfg_.advertsPerSecond;
+        uint32_t now = (uint32_t)clockMs_;
+
+        // Pick a class by advert share, then a device within it
+        double r = uniform();
+        int c = 0;
+        while (c < CLASS_COUNT - 1 && (r -= cfg_.classMix[c]) > 0) c++;
+        if (classCount_[c] == 0) c = firstNonEmptyClass();
+        Device& d = devices_[classStart_[c] + rng() % classCount_[c]];
+
+        const AdvertProfile& p = ADVERT_PROFILES[d.profile];
+        if (p.rotates && now >= d.rotateAtMs) {
+            randomAddress(d.addr);
+            d.rotateAtMs = now + cfg_.rotateMs;
+        }
+
+        // People drift a little between adverts
+        d.distance *= exp(0.02 * gaussian());
+        if (d.distance < 0.3) d.distance = 0.3;
+        if (d.distance > cfg_.crowdRadiusM) d.distance = cfg_.crowdRadiusM;
+
+        memcpy(adv.addr, d.addr, 6);
+        double rssi = p.txPower - 10.0 * cfg_.pathLossExponent * log10(d.distance) +
+                      cfg_.rssiSigmaDb * gaussian();
+        if (rssi > -20) rssi = -20;
+        if (rssi < -105) rssi = -105;
+        adv.rssiDbm = (int8_t)lround(rssi);
+        adv.timeMs = now;
+        buildPayload(adv, p, d.nameSuffix);
+    }
+
+    // Fill `out` with `count` adverts
+    void generate(std::vector<SyntheticAdvert>& out, size_t count) {
+        out.resize(count);
+        for (size_t i = 0; i < count; i++) next(out[i]);
+    }
+
+private:
+    struct Device {
+        uint8_t  addr[6];
+        uint8_t  profile;
+        uint16_t nameSuffix;
+        double   distance;
+        uint32_t rotateAtMs;
+    };
+
+    TrafficConfig       cfg_;
+    uint64_t            rng_;
+    double              clockMs_ = 0.0;
+    std::vector<Device> devices_;
+    size_t              classStart_[CLASS_COUNT] = {0};
+    size_t              classCount_[CLASS_COUNT] = {0};
+
+    // xorshift64* — deterministic across platforms
+    uint64_t rng() {
+        rng_ ^= rng_ >> 12;
+        rng_ ^= rng_ << 25;
+        rng_ ^= rng_ >> 27;
+        return rng_ * 0x2545F4914F6CDD1DULL;
+    }
+
+    double uniform() { return (rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+    double gaussian() {
+        double u1 = uniform();
+        double u2 = uniform();
+        if (u1 < 1e-12) u1 = 1e-12;
+        return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+
+    int firstNonEmptyClass() const {
+        for (int c = 0; c < CLASS_COUNT; c++) if (classCount_[c]) return c;
+        return 0;
+    }
+
+    void randomAddress(uint8_t addr[6]) {
+        uint64_t r = rng();
+        for (int i = 0; i < 6; i++) addr[i] = (uint8_t)(r >> (i * 8));
+        addr[0] = (addr[0] & 0x3F) | 0x40;   // Resolvable private address
+    }
+
+    // Public addresses: stable, vendor-assigned OUI
+    void publicAddress(uint8_t addr[6]) {
+        uint64_t r = rng();
+        for (int i = 0; i < 6; i++) addr[i] = (uint8_t)(r >> (i * 8));
+        addr[0] &= 0x3C;   // Globally administered, unicast
+    }
+
+    Device makeDevice(DeviceClass cls) {
+        int total = 0;
+        for (int i = 0; i < ADVERT_PROFILE_COUNT; i++) {
+            if (ADVERT_PROFILES[i].cls == cls) total += ADVERT_PROFILES[i].share;
+        }
+        int pick = (int)(rng() % (total ? total : 1));
+        uint8_t profile = 0;
+        for (int i = 0; i < ADVERT_PROFILE_COUNT; i++) {
+            if (ADVERT_PROFILES[i].cls != cls) continue;
+            profile = (uint8_t)i;
+            if ((pick -= ADVERT_PROFILES[i].share) < 0) break;
+        }
+
+        Device d;
+        d.profile = profile;
+        d.nameSuffix = (uint16_t)rng();
+        d.distance = cfg_.crowdRadiusM * sqrt(uniform());   // Uniform over a disc
+        if (ADVERT_PROFILES[profile].rotates) {
+            randomAddress(d.addr);
+            d.rotateAtMs = (uint32_t)(uniform() * cfg_.rotateMs);   // Staggered
+        } else {
+            publicAddress(d.addr);
+            d.rotateAtMs = UINT32_MAX;
+        }
+        return d;
+    }
+
+    void buildPayload(SyntheticAdvert& adv, const AdvertProfile& p, uint16_t nameSuffix) {
+        uint8_t* b = adv.payload;
+        uint8_t  n = 0;
+
+        // Flags: LE General Discoverable, BR/EDR not supported
+        b[n++] = 2; b[n++] = 0x01; b[n++] = 0x06;
+
+        if (p.uuid16) {
+            b[n++] = 3;
+            b[n++] = AD_TYPE_UUID16_COMPLETE;
+            b[n++] = p.uuid16 & 0xFF;
+            b[n++] = p.uuid16 >> 8;
+        }
+
+        if (p.companyId) {
+            uint8_t len = p.mfgLen;
+            if (n + 4 + len > 31) len = 31 - n - 4;
+            b[n++] = 3 + len;
+            b[n++] = AD_TYPE_MANUFACTURER;
+            b[n++] = p.companyId & 0xFF;
+            b[n++] = p.companyId >> 8;
+            uint64_t r = 0;
+            for (uint8_t i = 0; i < len; i++) {
+                if ((i & 7) == 0) r = rng();
+                b[n++] = (uint8_t)(r >> ((i & 7) * 8));
+            }
+        }
+
+        // Name goes in the scan response
+        if (p.name) {
+            char name[29];
+            int len = snprintf(name, sizeof(name), p.name, nameSuffix);
+            if (len > (int)sizeof(name) - 1) len = sizeof(name) - 1;
+            b[n++] = (uint8_t)(len + 1);
+            b[n++] = AD_TYPE_NAME_COMPLETE;
+            memcpy(b + n, name, len);
+            n += len;
+        }
+
+        adv.payloadLen = n;
+    }
+};
+
+#endif // TRAFFIC_GEN_H
@@ -0,0 +1,311 @@
+/*
+ * ESP-GlassHole — Detection Pipeline Stress Benchmark
+ *
+ * Drives the firmware's detection pipeline (pipeline.h, detection_json.h)
+ * with synthetic crowd traffic at several offered loads and reports
+ * throughput, per-advert latency percentiles and memory per stage.
+ *
+ * Simulated time advances with each advert at the offered rate, so
+ * cooldown hits and tracker churn match what a unit would see at that
+ * load; only the wall-clock cost is measured.
+ *
+ * Usage:
+ *   glasshole-bench [-r RATE[,RATE...]] [-n ADVERTS] [-s SEED]
+ *                   [-R ROTATE_S] [-f FILTER]
+ *
+ * License: AGPL-3.0
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <ArduinoJson.h>
+
+#include "detection.h"
+#include "detection_json.h"
+#include "pipeline.h"
+#include "traffic_gen.h"
+
+// ============================================================
+// Allocation Accounting
+// ============================================================
+
+static size_t allocCount = 0;
+static size_t allocBytes = 0;
+
+// noinline keeps GCC from pairing the inlined free() with new
+__attribute__((noinline)) void* operator new(size_t n) {
+    allocCount++;
+    allocBytes += n;
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+// JsonDocument allocates through its own Allocator (malloc), not new
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override {
+        allocCount++;
+        allocBytes += size;
+        return malloc(size);
+    }
+    void deallocate(void* ptr) override { free(ptr); }
+    void* reallocate(void* ptr, size_t newSize) override {
+        allocCount++;
+        allocBytes += newSize;
+        return realloc(ptr, newSize);
+    }
+};
+
+static CountingAllocator jsonAllocator;
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static long peakRssKb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// ============================================================
+// Stages
+// ============================================================
+// Each stage processes one advert and returns whether it alerted.
+
+// Reusable serialization buffer; matches what Serial would receive
+static char jsonBuf[512];
+
+struct StageContext {
+    GlassholePipeline::State tracker;
+    uint32_t      baseMs = 0;   // Shifts time forward on each replay lap
+    size_t        jsonBytes = 0;
+};
+
+typedef bool (*StageFn)(StageContext& ctx, const SyntheticAdvert& adv);
+
+static bool stageMatch(StageContext&, const SyntheticAdvert& adv) {
+    DetectionResult result;
+    if (adv.rssi() < RSSI_THRESHOLD_DEFAULT) return false;
+    return detectGlasses(adv, result);
+}
+
+static bool stageProcess(StageContext& ctx, const SyntheticAdvert& adv) {
+    DetectionResult result;
+    return processAdvertisement(adv, ctx.tracker, ctx.baseMs + adv.timeMs, result);
+}
+
+static bool stageSerialize(StageContext& ctx, const SyntheticAdvert& adv) {
+    DetectionResult result;
+    if (!detectGlasses(adv, result)) return false;
+    JsonDocument doc(&jsonAllocator);
+    buildDetectionJSON(doc, adv, result, adv.timeMs);
+    ctx.jsonBytes += serializeJson(doc, jsonBuf, sizeof(jsonBuf));
+    return true;
+}
+
+// The firmware's composition with a serial sink writing to jsonBuf
+static bool stagePipeline(StageContext& ctx, const SyntheticAdvert& adv) {
+    uint32_t now = ctx.baseMs + adv.timeMs;
+    return GlassholePipeline::run(adv, ctx.tracker, now,
+        [&](const SyntheticAdvert& a, const DetectionResult& result) {
+            JsonDocument doc(&jsonAllocator);
+            buildDetectionJSON(doc, a, result, now);
+            ctx.jsonBytes += serializeJson(doc, jsonBuf, sizeof(jsonBuf));
+        });
+}
+
+struct Stage {
+    const char* name;
+    const char* description;
+    StageFn     fn;
+};
+
+static const Stage STAGES[] = {
+    { "match",     "RSSI gate + matchers",                  stageMatch },
+    { "process",   "gate + matchers + cooldown + tracking", stageProcess },
+    { "serialize", "detection JSON for every match",        stageSerialize },
+    { "pipeline",  "full onResult equivalent",              stagePipeline },
+};
+
+// ============================================================
+// Runner
+// ============================================================
+
+struct BenchResult {
+    double   nsPerAdvert;
+    double   advertsPerSec;
+    uint32_t p50, p99, p999, max;   // ns
+    double   alertsPerSimSec;
+    double   allocsPerAdvert;
+    double   allocBytesPerAdvert;
+    double   jsonBytesPerAlert;
+};
+
+static uint32_t percentile(std::vector<uint32_t>& v, double q) {
+    size_t k = (size_t)(q * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static BenchResult runStage(const Stage& stage, const std::vector<SyntheticAdvert>& adverts,
+                            uint32_t spanMs) {
+    BenchResult r = {};
+    const size_t n = adverts.size();
+
+    // Throughput pass: repeat until at least 0.2 s of wall time
+    StageContext ctx;
+    size_t alerts = 0;
+    size_t laps = 0;
+    size_t allocsBefore = allocCount;
+    size_t bytesBefore = allocBytes;
+    uint64_t start = nowNs();
+    uint64_t elapsed = 0;
+    do {
+        for (size_t i = 0; i < n; i++) {
+            if (stage.fn(ctx, adverts[i])) alerts++;
+        }
+        ctx.baseMs += spanMs;
+        laps++;
+        elapsed = nowNs() - start;
+    } while (elapsed < 200000000ull);
+
+    size_t total = n * laps;
+    r.nsPerAdvert = (double)elapsed / total;
+    r.advertsPerSec = 1e9 / r.nsPerAdvert;
+    r.alertsPerSimSec = spanMs ? (double)alerts / laps / (spanMs / 1000.0) : 0.0;
+    r.allocsPerAdvert = (double)(allocCount - allocsBefore) / total;
+    r.allocBytesPerAdvert = (double)(allocBytes - bytesBefore) / total;
+    r.jsonBytesPerAlert = alerts ? (double)ctx.jsonBytes / alerts : 0.0;
+
+    // Latency pass: time each advert individually on a fresh tracker
+    StageContext lctx;
+    std::vector<uint32_t> lat(n);
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t a = nowNs();
+        uint64_t b = nowNs();
+        if (b - a < overhead) overhead = b - a;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint64_t a = nowNs();
+        stage.fn(lctx, adverts[i]);
+        uint64_t b = nowNs();
+        uint64_t d = b - a;
+        lat[i] = (uint32_t)(d > overhead ? d - overhead : 0);
+    }
+    r.max = *std::max_element(lat.begin(), lat.end());
+    r.p50 = percentile(lat, 0.50);
+    r.p99 = percentile(lat, 0.99);
+    r.p999 = percentile(lat, 0.999);
+    return r;
+}
+
+// ============================================================
+// Main
+// ============================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [-r RATE[,RATE...]] [-n ADVERTS] [-s SEED] [-R ROTATE_S] [-f FILTER]\n"
+        "  -r  offered loads in adverts/s (default 500,5000,50000)\n"
+        "  -n  adverts generated per load (default 200000)\n"
+        "  -s  traffic seed (default 1)\n"
+        "  -R  private address lifetime in seconds (default 900)\n"
+        "  -f  only run stages whose name contains FILTER\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> rates = { 500, 5000, 50000 };
+    size_t advertCount = 200000;
+    uint64_t seed = 1;
+    uint32_t rotateS = 900;
+    const char* filter = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:s:R:f:h")) != -1) {
+        switch (opt) {
+        case 'r': {
+            rates.clear();
+            char* p = optarg;
+            while (*p) {
+                rates.push_back((uint32_t)strtoul(p, &p, 10));
+                if (*p == ',') p++;
+                else if (*p) { usage(argv[0]); return 2; }
+            }
+            break;
+        }
+        case 'n': advertCount = strtoul(optarg, nullptr, 10); break;
+        case 's': seed = strtoull(optarg, nullptr, 10); break;
+        case 'R': rotateS = strtoul(optarg, nullptr, 10); break;
+        case 'f': filter = optarg; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (rates.empty() || advertCount == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    printf("ESP-GlassHole detection benchmark\n");
+    printf("  tracker state: %zu bytes (%d slots), advert: %zu bytes\n",
+           sizeof(GlassholePipeline::State), MAX_TRACKED_DEVICES, sizeof(SyntheticAdvert));
+    printf("  tiers: HIGH=%d MEDIUM=%d LOW=%d (%zu company IDs), RSSI gate %d dBm, cooldown %s\n",
+           ENABLE_TIER_HIGH, ENABLE_TIER_MEDIUM, ENABLE_TIER_LOW,
+           CompanyTable<CONFIG_TIER_MASK>::SIZE, RSSI_THRESHOLD_DEFAULT,
+           ENABLE_COOLDOWN ? "on" : "off");
+    printf("  matchers: company=%d uuid=%d name=%d oui=%d\n\n",
+           PIPELINE_COMPANY_ID, PIPELINE_SERVICE_UUID, PIPELINE_DEVICE_NAME, PIPELINE_OUI);
+
+    printf("Latencies in ns. alerts/s is per simulated second.\n\n");
+    printf("%-22s %9s %12s %7s %7s %7s %8s %9s %9s %9s %8s\n",
+           "Benchmark", "ns/advert", "adverts/s", "p50", "p99", "p99.9", "max",
+           "alerts/s", "allocs/op", "heapB/op", "B/alert");
+    printf("%s\n", std::string(120, '-').c_str());
+
+    for (uint32_t rate : rates) {
+        TrafficConfig cfg;
+        cfg.advertsPerSecond = rate;
+        cfg.seed = seed;
+        cfg.rotateMs = rotateS * 1000;
+        TrafficGenerator gen(cfg);
+
+        std::vector<SyntheticAdvert> adverts;
+        gen.generate(adverts, advertCount);
+        uint32_t spanMs = adverts.back().timeMs + 1;
+
+        for (const Stage& stage : STAGES) {
+            if (filter && !strstr(stage.name, filter)) continue;
+            BenchResult r = runStage(stage, adverts, spanMs);
+
+            char name[32];
+            snprintf(name, sizeof(name), "BM_%s/%u", stage.name, rate);
+            printf("%-22s %9.1f %12.0f %7u %7u %7u %8u %9.1f %9.2f %9.1f %8.1f%s\n",
+                   name, r.nsPerAdvert, r.advertsPerSec, r.p50, r.p99, r.p999, r.max,
+                   r.alertsPerSimSec, r.allocsPerAdvert, r.allocBytesPerAdvert,
+                   r.jsonBytesPerAlert,
+                   r.advertsPerSec < rate ? "  OVERLOAD" : "");
+        }
+        printf("  crowd %zu devices, %zu adverts over %.1f s simulated, peak RSS %ld KiB\n\n",
+               gen.crowdSize(), adverts.size(), spanMs / 1000.0, peakRssKb());
+    }
+    return 0;
+}
@@ -0,0 +1,529 @@
+/*
+ * ESP-GlassHole — Multi-Sensor Collector
+ *
+ * Reads the JSON line stream from several ESP-GlassHole units at once,
+ * merges detections by device into a time-ordered store, re-emits them
+ * on stdout tagged with the sensor name, and serves Prometheus metrics.
+ * With three or more sensors placed (-s), devices are also localized.
+ *
+ * Usage:
+ *   glasshole-collector [-l ADDR:PORT] [-q] [-s NAME=X,Y[,TX,N]]...
+ *                       [-a MAC=X,Y]... [NAME=]PORT...
+ *
+ *   -l ADDR:PORT   Metrics listen address (default 127.0.0.1:9464)
+ *   -q             Don't echo detections to stdout
+ *   -s ...         Sensor position in metres, optional path-loss seed
+ *   -a MAC=X,Y     Reference device at a known position (calibration)
+ *   NAME=PORT      Label a port, e.g. lobby=/dev/ttyUSB0
+ *
+ * License: AGPL-3.0
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "collector_config.h"
+#include "event_store.h"
+#include "localizer.h"
+#include "metrics.h"
+#include "sensor_port.h"
+#include "serial_stream.h"
+
+// ============================================================
+// Global State
+// ============================================================
+
+// epoll tags: sensor index, or one of these
+#define TAG_LISTENER  0xFFFFFFFFull
+#define TAG_CLIENT    (1ull << 32)
+
+static volatile sig_atomic_t running = 1;
+
+static std::vector<SensorPort> ports;
+static EventStore              store;
+static Localizer               localizer;
+static int                     epollFd = -1;
+static int                     listenFd = -1;
+static bool                    echoDetections = true;
+
+// A metrics request being answered: the rendered response and how much
+// of it the socket has taken so far
+struct MetricsClient {
+    std::string response;
+    size_t      sent = 0;
+    uint64_t    deadlineMs = 0;     // Closed if no progress by then
+    bool        waitWritable = false;
+};
+
+static std::unordered_map<int, MetricsClient> clients;
+
+static uint64_t monotonicMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void onSignal(int) {
+    running = 0;
+}
+
+// ============================================================
+// Line Handling
+// ============================================================
+
+static void echoDetection(const SensorPort& port, std::string_view line, uint64_t timeMs) {
+    // Splice sensor name and aligned time into the original object
+    size_t brace = line.find('{');
+    if (brace == std::string_view::npos) return;
+    std::string_view rest = line.substr(brace + 1);
+    printf("{\"sensor\":\"%s\",\"t\":%llu,%.*s\n",
+           port.nameJson.c_str(), (unsigned long long)timeMs,
+           (int)rest.size(), rest.data());
+}
+
+static void echoPosition(const uint8_t mac[6], const PositionFix& fix) {
+    printf("{\"type\":\"position\",\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\","
+           "\"t\":%llu,\"x\":%.2f,\"y\":%.2f,\"sigma\":%.2f,\"sensors\":%u}\n",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+           (unsigned long long)fix.timeMs, fix.x, fix.y, fix.sigma, fix.sensors);
+}
+
+static void handleLine(uint16_t index, std::string_view line, uint64_t nowMs) {
+    SensorPort& port = ports[index];
+    port.stats.lines++;
+
+    // The firmware's startup banner and the ROM boot log are plain text;
+    // only lines that open an object count against parse errors
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos || line[start] != '{') {
+        port.stats.nonJsonLines++;
+        return;
+    }
+
+    SensorMessage msg;
+    if (!parseSensorLine(line, msg)) {
+        port.stats.parseErrors++;
+        return;
+    }
+    port.lastMessageMs = nowMs;
+
+    switch (msg.type) {
+    case MSG_DETECTION: {
+        port.stats.detections++;
+        uint64_t timeMs = msg.hasTs ? port.clock.align(msg.ts, nowMs) : nowMs;
+        store.add(msg, index, timeMs);
+        if (echoDetections) echoDetection(port, line, timeMs);
+
+        // Path-loss models are fitted to BLE advertising power; a Wi-Fi
+        // frame's RSSI would skew both the fix and the anchor fit
+        if (msg.wifi) {
+            port.stats.wifiDetections++;
+            break;
+        }
+
+        PositionFix fix;
+        if (localizer.update(macKey(msg.mac), index, msg.rssi, timeMs, fix) &&
+            echoDetections) {
+            echoPosition(msg.mac, fix);
+        }
+        break;
+    }
+    case MSG_STATUS:
+        port.stats.statuses++;
+        port.uptime = msg.uptime;
+        port.freeHeap = msg.freeHeap;
+        port.totalScans = msg.totalScans;
+        port.totalDetections = msg.totalDetections;
+        port.trackedDevices = msg.trackedDevices;
+        if (!msg.board.empty()) port.board.assign(msg.board.data(), msg.board.size());
+        break;
+    case MSG_HEARTBEAT:
+        port.stats.heartbeats++;
+        port.uptime = msg.uptime;
+        port.freeHeap = msg.freeHeap;
+        break;
+    case MSG_BOOT:
+        port.stats.boots++;
+        port.clock.reset();
+        port.board.assign(msg.board.data(), msg.board.size());
+        port.env.assign(msg.env.data(), msg.env.size());
+        port.version.assign(msg.version.data(), msg.version.size());
+        memcpy(port.bootMs, msg.bootMs, sizeof(port.bootMs));
+        break;
+    default:
+        break;
+    }
+}
+
+// ============================================================
+// Serial Ports
+// ============================================================
+
+static void disconnectPort(uint16_t index, uint64_t nowMs) {
+    SensorPort& port = ports[index];
+    if (!port.connected()) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, port.fd, nullptr);
+    closeSensorPort(port);
+    port.nextRetryMs = nowMs + COLLECTOR_RECONNECT_MS;
+    fprintf(stderr, "collector: %s disconnected\n", port.name.c_str());
+}
+
+static void connectPort(uint16_t index, uint64_t nowMs) {
+    SensorPort& port = ports[index];
+    int err = openSensorPort(port);
+    if (err < 0) {
+        if (port.nextRetryMs == 0) {
+            fprintf(stderr, "collector: %s: %s\n", port.path.c_str(), strerror(-err));
+        }
+        port.nextRetryMs = nowMs + COLLECTOR_RECONNECT_MS;
+        return;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = index;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, port.fd, &ev);
+
+    if (port.everConnected) port.stats.reconnects++;
+    port.everConnected = true;
+    fprintf(stderr, "collector: %s connected (%s)\n", port.name.c_str(), port.path.c_str());
+}
+
+static void readPort(uint16_t index, uint64_t nowMs) {
+    SensorPort& port = ports[index];
+
+    while (port.connected()) {
+        ssize_t n = read(port.fd, port.buffer.writePtr(), port.buffer.writeSpace());
+        if (n > 0) {
+            port.stats.bytes += n;
+            port.buffer.commit((size_t)n, [&](std::string_view line) {
+                handleLine(index, line, nowMs);
+            });
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        // EOF, EIO (pty master closed) or a real error
+        disconnectPort(index, nowMs);
+        return;
+    }
+}
+
+// ============================================================
+// Metrics Endpoint
+// ============================================================
+
+static int openListener(const char* addr, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 ||
+        listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void acceptClients(uint64_t nowMs) {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = TAG_CLIENT | (uint32_t)fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        clients[fd].deadlineMs = nowMs + COLLECTOR_SEND_TIMEOUT_MS;
+    }
+}
+
+static void closeClient(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+// Any request gets the metrics page; scrapers only ever GET /metrics.
+// The socket stays non-blocking: whatever doesn't fit in the socket
+// buffer is kept and sent as EPOLLOUT reports space.
+static void serveClient(int fd, uint64_t nowMs) {
+    auto it = clients.find(fd);
+    if (it == clients.end()) return;
+    MetricsClient& c = it->second;
+
+    if (c.response.empty()) {
+        char req[1024];
+        ssize_t n = read(fd, req, sizeof(req));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) {
+            closeClient(fd);
+            return;
+        }
+
+        std::string body;
+        body.reserve(8192);
+        renderMetrics(body, ports, store, localizer, nowMs);
+
+        char head[160];
+        int headLen = snprintf(head, sizeof(head),
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: %zu\r\n"
+            "Connection: close\r\n\r\n", body.size());
+        c.response.reserve(headLen + body.size());
+        c.response.assign(head, headLen);
+        c.response += body;
+    }
+
+    while (c.sent < c.response.size()) {
+        ssize_t w = write(fd, c.response.data() + c.sent, c.response.size() - c.sent);
+        if (w > 0) {
+            c.sent += w;
+            c.deadlineMs = nowMs + COLLECTOR_SEND_TIMEOUT_MS;
+            continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && errno == EAGAIN) {
+            if (!c.waitWritable) {
+                struct epoll_event ev = {};
+                ev.events = EPOLLOUT;
+                ev.data.u64 = TAG_CLIENT | (uint32_t)fd;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+                c.waitWritable = true;
+            }
+            return;
+        }
+        break;   // Peer gone
+    }
+    closeClient(fd);
+}
+
+// Drop scrapers that stopped reading (or never sent a request)
+static void expireClients(uint64_t nowMs) {
+    for (auto it = clients.begin(); it != clients.end();) {
+        if (nowMs <= it->second.deadlineMs) {
+            ++it;
+            continue;
+        }
+        int fd = it->first;
+        ++it;
+        closeClient(fd);
+    }
+}
+
+// ============================================================
+// Main
+// ============================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [-l ADDR:PORT] [-q] [-s NAME=X,Y[,TX,N]]... "
+                    "[-a MAC=X,Y]... [NAME=]PORT...\n", argv0);
+}
+
+// Split "KEY=a,b[,c,d]" into key and up to four numbers
+static int parseKeyValues(const char* arg, std::string& key, double vals[4]) {
+    const char* eq = strchr(arg, '=');
+    if (!eq) return -1;
+    key.assign(arg, eq - arg);
+    int n = 0;
+    const char* p = eq + 1;
+    while (n < 4 && *p) {
+        char* end;
+        vals[n] = strtod(p, &end);
+        if (end == p) return -1;
+        n++;
+        if (*end == '\0') break;
+        if (*end != ',') return -1;
+        p = end + 1;
+    }
+    return n;
+}
+
+int main(int argc, char** argv) {
+    std::string listenAddr = COLLECTOR_METRICS_ADDR;
+    int listenPort = COLLECTOR_METRICS_PORT;
+    std::vector<const char*> placements;
+    std::vector<const char*> anchors;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:qs:a:h")) != -1) {
+        switch (opt) {
+        case 'l': {
+            std::string arg = optarg;
+            size_t colon = arg.rfind(':');
+            if (colon == std::string::npos) {
+                listenPort = atoi(arg.c_str());
+            } else {
+                listenAddr = arg.substr(0, colon);
+                listenPort = atoi(arg.c_str() + colon + 1);
+            }
+            break;
+        }
+        case 'q':
+            echoDetections = false;
+            break;
+        case 's':
+            placements.push_back(optarg);
+            break;
+        case 'a':
+            anchors.push_back(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (ports.size() >= COLLECTOR_MAX_SENSORS) {
+            fprintf(stderr, "collector: at most %d ports\n", COLLECTOR_MAX_SENSORS);
+            return 2;
+        }
+        SensorPort port;
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            port.name = arg.substr(0, eq);
+            port.path = arg.substr(eq + 1);
+        } else {
+            port.path = arg;
+            size_t slash = arg.rfind('/');
+            port.name = (slash == std::string::npos) ? arg : arg.substr(slash + 1);
+        }
+        appendJsonEscaped(port.nameJson, port.name);
+        ports.push_back(std::move(port));
+    }
+    if (ports.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Sensor placement refers to port names, so resolve it after the ports
+    localizer.sites.resize(ports.size());
+    for (const char* arg : placements) {
+        std::string name;
+        double v[4];
+        int n = parseKeyValues(arg, name, v);
+        size_t i = 0;
+        while (i < ports.size() && ports[i].name != name) i++;
+        if ((n != 2 && n != 4) || i == ports.size()) {
+            fprintf(stderr, "collector: bad sensor placement '%s'\n", arg);
+            return 2;
+        }
+        SensorSite& site = localizer.sites[i];
+        site.x = v[0];
+        site.y = v[1];
+        site.placed = true;
+        if (n == 4) {
+            site.model.txPower = v[2];
+            site.model.exponent = v[3];
+        }
+    }
+    for (const char* arg : anchors) {
+        std::string mac;
+        double v[4];
+        uint8_t bytes[6];
+        if (parseKeyValues(arg, mac, v) != 2 || !parseMac(mac, bytes)) {
+            fprintf(stderr, "collector: bad anchor '%s'\n", arg);
+            return 2;
+        }
+        localizer.addAnchor(macKey(bytes), v[0], v[1]);
+    }
+    if (!placements.empty() && !localizer.enabled()) {
+        fprintf(stderr, "collector: localization needs %d placed sensors\n",
+                LOCALIZE_MIN_SENSORS);
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    listenFd = openListener(listenAddr.c_str(), listenPort);
+    if (listenFd < 0) {
+        fprintf(stderr, "collector: cannot listen on %s:%d: %s\n",
+                listenAddr.c_str(), listenPort, strerror(errno));
+        return 1;
+    }
+    struct epoll_event lev = {};
+    lev.events = EPOLLIN;
+    lev.data.u64 = TAG_LISTENER;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &lev);
+    fprintf(stderr, "collector: metrics on http://%s:%d/metrics\n",
+            listenAddr.c_str(), listenPort);
+
+    uint64_t now = monotonicMs();
+    for (uint16_t i = 0; i < ports.size(); i++) connectPort(i, now);
+
+    uint64_t lastExpire = now;
+    struct epoll_event events[32];
+
+    while (running) {
+        int n = epoll_wait(epollFd, events, 32, 250);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        now = monotonicMs();
+
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == TAG_LISTENER) {
+                acceptClients(now);
+            } else if (tag & TAG_CLIENT) {
+                serveClient((int)(uint32_t)tag, now);
+            } else {
+                uint16_t index = (uint16_t)tag;
+                if (events[i].events & EPOLLIN) readPort(index, now);
+                if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+                    disconnectPort(index, now);
+                }
+            }
+        }
+        if (echoDetections) fflush(stdout);
+
+        // Reopen lost ports
+        for (uint16_t i = 0; i < ports.size(); i++) {
+            if (!ports[i].connected() && now >= ports[i].nextRetryMs) connectPort(i, now);
+        }
+
+        if (now - lastExpire >= 1000) {
+            store.expire(now);
+            localizer.expire(now);
+            expireClients(now);
+            lastExpire = now;
+        }
+    }
+
+    for (uint16_t i = 0; i < ports.size(); i++) closeSensorPort(ports[i]);
+    while (!clients.empty()) closeClient(clients.begin()->first);
+    close(listenFd);
+    close(epollFd);
+    return 0;
+}
@@ -0,0 +1,547 @@
+/*
+ * ESP-GlassHole — Collector End-to-End Test
+ *
+ * Runs the real collector binary against three pseudo-terminals standing
+ * in for ESP-GlassHole units, writes the lines the firmware would send
+ * (startup banner, boot, status, detections of a device at a known
+ * position, corrupt lines, a Wi-Fi detection with an RSSI far off the BLE
+ * model), then checks what comes out:
+ *
+ *   stdout   every line is one JSON object, detections carry the (escaped)
+ *            sensor name, position fixes converge on the true position and
+ *            the Wi-Fi detection does not move them
+ *   metrics  per-sensor counters (banner text is not a parse error), boot
+ *            phases, localization counters, and an idle client neither
+ *            blocks a scrape nor lingers
+ *   clock    SensorClock follows a sensor crystal running slow
+ *
+ * Exits non-zero if any check fails.
+ *
+ * Usage:
+ *   glasshole-collector-e2e [-c COLLECTOR] [-v]
+ *
+ *   -c PATH   Collector binary (default .pio/build/collector/program)
+ *   -v        Show the collector's stderr and every check
+ *
+ * License: AGPL-3.0
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "event_store.h"
+#include "serial_stream.h"
+
+#define E2E_ROUNDS        8        // Detection lines per sensor
+#define E2E_ROUND_MS      100
+#define E2E_TX_POWER      -59.0
+#define E2E_EXPONENT      2.5
+#define E2E_TRUE_X        3.0
+#define E2E_TRUE_Y        2.0
+#define E2E_MAX_ERROR_M   1.0      // Integer RSSI alone costs ~0.3 m here
+#define E2E_TIMEOUT_MS    3000
+#define E2E_WIFI_SENSOR   0        // Also hears the device over Wi-Fi, once
+#define E2E_WIFI_RSSI     -35      // ~0.1 m on the BLE model
+
+static bool verbose = false;
+static int  failures = 0;
+
+static void check(bool ok, const char* fmt, ...) {
+    if (!ok) failures++;
+    if (ok && !verbose) return;
+    va_list ap;
+    va_start(ap, fmt);
+    printf("%s ", ok ? "  ok  " : "  FAIL");
+    vprintf(fmt, ap);
+    putchar('\n');
+    va_end(ap);
+}
+
+static uint64_t monotonicMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sleepMs(int ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, nullptr);
+}
+
+// ============================================================
+// Simulated Sensors
+// ============================================================
+
+struct FakeSensor {
+    std::string name;
+    double      x;
+    double      y;
+    uint32_t    bootTs;      // Sensor millis() at the first line
+    int         master = -1;
+    int         slave = -1;  // Held open so the pty survives reconnects
+    std::string path;
+
+    FakeSensor(const char* name, double x, double y, uint32_t bootTs)
+        : name(name), x(x), y(y), bootTs(bootTs) {}
+};
+
+// What the firmware prints before its first JSON line: ROM boot log, then
+// the startup banner (blank lines are dropped by the collector)
+static const char* const BANNER_LINES[] = {
+    "ets Jun  8 2016 00:22:57",
+    "rst:0x1 (POWERON_RESET),boot:0x8 (SPI_FAST_FLASH_BOOT)",
+    "========================================",
+    "  ESP-GlassHole — AR Glasses Detector",
+    "========================================",
+    "  Board:  ESP32-S3",
+    "  RSSI:   -75 dBm threshold",
+    "========================================",
+};
+#define BANNER_LINE_COUNT (sizeof(BANNER_LINES) / sizeof(BANNER_LINES[0]))
+
+static bool openPty(FakeSensor& s) {
+    s.master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (s.master < 0 || grantpt(s.master) != 0 || unlockpt(s.master) != 0) return false;
+    const char* path = ptsname(s.master);
+    if (!path) return false;
+    s.path = path;
+
+    // Raw before the collector opens it, so nothing is echoed back
+    s.slave = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (s.slave < 0) return false;
+    struct termios tio;
+    if (tcgetattr(s.slave, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    return tcsetattr(s.slave, TCSANOW, &tio) == 0;
+}
+
+static void sendLine(const FakeSensor& s, const std::string& line) {
+    std::string out = line + "\r\n";
+    size_t off = 0;
+    while (off < out.size()) {
+        ssize_t n = write(s.master, out.data() + off, out.size() - off);
+        if (n <= 0) return;
+        off += n;
+    }
+}
+
+static int expectedRssi(const FakeSensor& s) {
+    double d = hypot(E2E_TRUE_X - s.x, E2E_TRUE_Y - s.y);
+    return (int)lround(E2E_TX_POWER - 10.0 * E2E_EXPONENT * log10(d));
+}
+
+// ============================================================
+// Collector Process
+// ============================================================
+
+struct Collector {
+    pid_t       pid = -1;
+    int         out = -1;    // Its stdout
+    int         port = 0;
+    std::string buffered;
+};
+
+static int freeTcpPort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sa);
+    int port = 0;
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) == 0 &&
+        getsockname(fd, (struct sockaddr*)&sa, &len) == 0) {
+        port = ntohs(sa.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+static bool startCollector(Collector& c, const char* binary, const std::vector<FakeSensor>& sensors) {
+    c.port = freeTcpPort();
+    std::vector<std::string> args = { binary, "-l", "127.0.0.1:" + std::to_string(c.port) };
+    for (const FakeSensor& s : sensors) {
+        char place[160];
+        snprintf(place, sizeof(place), "%s=%g,%g,%g,%g", s.name.c_str(), s.x, s.y,
+                 E2E_TX_POWER, E2E_EXPONENT);
+        args.push_back("-s");
+        args.push_back(place);
+    }
+    for (const FakeSensor& s : sensors) args.push_back(s.name + "=" + s.path);
+
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) return false;
+    c.pid = fork();
+    if (c.pid < 0) return false;
+    if (c.pid == 0) {
+        dup2(pipeFds[1], STDOUT_FILENO);
+        if (!verbose) {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDERR_FILENO);
+        }
+        std::vector<char*> argv;
+        for (std::string& a : args) argv.push_back(&a[0]);
+        argv.push_back(nullptr);
+        execv(binary, argv.data());
+        _exit(127);
+    }
+    close(pipeFds[1]);
+    c.out = pipeFds[0];
+    fcntl(c.out, F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+// Everything the collector has printed so far, as complete lines
+static std::vector<std::string> collectorLines(Collector& c) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(c.out, buf, sizeof(buf))) > 0) c.buffered.append(buf, n);
+
+    std::vector<std::string> lines;
+    size_t start = 0, nl;
+    while ((nl = c.buffered.find('\n', start)) != std::string::npos) {
+        lines.push_back(c.buffered.substr(start, nl - start));
+        start = nl + 1;
+    }
+    c.buffered.erase(0, start);
+    return lines;
+}
+
+static bool stopCollector(Collector& c) {
+    int status = 0;
+    kill(c.pid, SIGTERM);
+    waitpid(c.pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// ============================================================
+// Metrics
+// ============================================================
+
+static int connectMetrics(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Body of GET /metrics, or empty on failure
+static std::string scrape(int port) {
+    int fd = connectMetrics(port);
+    if (fd < 0) return std::string();
+    const char req[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    if (write(fd, req, sizeof(req) - 1) != (ssize_t)sizeof(req) - 1) {
+        close(fd);
+        return std::string();
+    }
+
+    std::string resp;
+    char buf[4096];
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    while (poll(&pfd, 1, E2E_TIMEOUT_MS) == 1) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        resp.append(buf, n);
+    }
+    close(fd);
+
+    size_t body = resp.find("\r\n\r\n");
+    if (resp.compare(0, 12, "HTTP/1.0 200") != 0 || body == std::string::npos) return std::string();
+    return resp.substr(body + 4);
+}
+
+// Value of one series, e.g. metric(page, "glasshole_sensor_up{sensor=\"a\"}")
+static double metric(const std::string& page, const std::string& series) {
+    std::string key = "\n" + series + " ";
+    size_t at = page.find(key);
+    if (at == std::string::npos) return NAN;
+    return strtod(page.c_str() + at + key.size(), nullptr);
+}
+
+static std::string sensorSeries(const char* name, const FakeSensor& s) {
+    std::string label;
+    for (char c : s.name) {
+        if (c == '\\' || c == '"') label += '\\';
+        label += c;
+    }
+    return std::string(name) + "{sensor=\"" + label + "\"}";
+}
+
+// ============================================================
+// Checks
+// ============================================================
+
+static void checkClockDrift() {
+    // Sensor crystal 60 ppm slow, constant latency, a line every 200 ms:
+    // aligned time should stay on the arrival time
+    SensorClock clock;
+    double worst = 0.0;
+    for (uint64_t hostMs = 1000; hostMs < 1000 + 3600 * 1000; hostMs += 200) {
+        uint32_t sensorTs = (uint32_t)((double)hostMs * (1.0 - 60e-6));
+        double err = (double)clock.align(sensorTs, hostMs) - (double)hostMs;
+        if (fabs(err) > worst) worst = fabs(err);
+    }
+    check(worst < 5.0, "clock: slow sensor tracked within %.1f ms over 1 h (limit 5)", worst);
+}
+
+static void checkOutput(const std::vector<std::string>& lines, const std::vector<FakeSensor>& sensors,
+                        size_t& positions) {
+    size_t detections[3] = { 0, 0, 0 };
+    size_t wifiDetections = 0;
+    size_t fixesAfterWifi = 0;
+    size_t malformed = 0;
+    double lastX = NAN, lastY = NAN;
+    int lastSensors = 0;
+    positions = 0;
+
+    for (const std::string& line : lines) {
+        JsonScanner scanner(line);
+        JsonField f;
+        std::string_view type, sensor, source;
+        double x = NAN, y = NAN;
+        int64_t n = 0;
+        while (scanner.next(f)) {
+            if (f.key == "type") type = f.value;
+            else if (f.key == "sensor") sensor = f.value;
+            else if (f.key == "source") source = f.value;
+            else if (f.key == "x") x = strtod(std::string(f.value).c_str(), nullptr);
+            else if (f.key == "y") y = strtod(std::string(f.value).c_str(), nullptr);
+            else if (f.key == "sensors") parseInt(f.value, n);
+        }
+        if (!scanner.ok()) {
+            malformed++;
+            continue;
+        }
+        if (type == "position") {
+            positions++;
+            if (wifiDetections) fixesAfterWifi++;
+            lastX = x;
+            lastY = y;
+            lastSensors = (int)n;
+        } else if (type == "detection" && source == "wifi") {
+            wifiDetections++;
+        } else if (type == "detection") {
+            for (size_t i = 0; i < sensors.size(); i++) {
+                std::string escaped;
+                appendJsonEscaped(escaped, sensors[i].name);
+                if (sensor == escaped) detections[i]++;
+            }
+        }
+    }
+
+    check(malformed == 0, "stdout: %zu of %zu lines are not JSON objects", malformed, lines.size());
+    for (size_t i = 0; i < sensors.size(); i++) {
+        check(detections[i] == E2E_ROUNDS, "stdout: %zu detections from '%s' (expected %d)",
+              detections[i], sensors[i].name.c_str(), E2E_ROUNDS);
+    }
+    check(wifiDetections == 1, "stdout: %zu Wi-Fi detections echoed (expected 1)", wifiDetections);
+    size_t expectFixes = E2E_ROUNDS * sensors.size() - (LOCALIZE_MIN_SENSORS - 1);
+    check(positions == expectFixes, "stdout: %zu position fixes (expected %zu)", positions, expectFixes);
+    check(fixesAfterWifi == 0, "stdout: %zu position fixes after the Wi-Fi detection", fixesAfterWifi);
+    double err = hypot(lastX - E2E_TRUE_X, lastY - E2E_TRUE_Y);
+    check(err < E2E_MAX_ERROR_M && lastSensors == 3,
+          "stdout: last fix (%.2f, %.2f) from %d sensors, %.2f m from truth (limit %.1f)",
+          lastX, lastY, lastSensors, err, E2E_MAX_ERROR_M);
+}
+
+static void checkMetrics(const std::string& page, const std::vector<FakeSensor>& sensors,
+                         size_t positions) {
+    check(!page.empty(), "metrics: scrape answered");
+    for (size_t i = 0; i < sensors.size(); i++) {
+        const FakeSensor& s = sensors[i];
+        double up = metric(page, sensorSeries("glasshole_sensor_up", s));
+        double det = metric(page, sensorSeries("glasshole_sensor_detections_total", s));
+        double wifi = metric(page, sensorSeries("glasshole_sensor_wifi_detections_total", s));
+        double err = metric(page, sensorSeries("glasshole_sensor_parse_errors_total", s));
+        double text = metric(page, sensorSeries("glasshole_sensor_non_json_lines_total", s));
+        double boots = metric(page, sensorSeries("glasshole_sensor_boots_total", s));
+        double heap = metric(page, sensorSeries("glasshole_sensor_free_heap_bytes", s));
+        double expectWifi = (i == E2E_WIFI_SENSOR) ? 1 : 0;
+        check(up == 1 && det == E2E_ROUNDS + expectWifi && wifi == expectWifi && boots == 1 &&
+              heap == 200000 + (double)i,
+              "metrics: '%s' up %g, detections %g (%g Wi-Fi), boots %g, free heap %g",
+              s.name.c_str(), up, det, wifi, boots, heap);
+        check(err == (i == 1 ? 2 : 0), "metrics: '%s' parse errors %g", s.name.c_str(), err);
+        check(text == BANNER_LINE_COUNT, "metrics: '%s' %g non-JSON lines (banner has %zu)",
+              s.name.c_str(), text, BANNER_LINE_COUNT);
+    }
+
+    std::string phase = "glasshole_sensor_boot_phase_ms{sensor=\"" + sensors[0].name + "\",phase=\"";
+    double setup = metric(page, phase + "setup\"}");
+    double scanStart = metric(page, phase + "scanStart\"}");
+    double firstDetection = metric(page, phase + "firstDetection\"}");
+    check(setup == 35 && scanStart == 210 && isnan(firstDetection),
+          "metrics: boot phases setup %g, scanStart %g, firstDetection %g (not reached)",
+          setup, scanStart, firstDetection);
+
+    double events = metric(page, "glasshole_events_total");
+    double updates = metric(page, "glasshole_localization_updates_total");
+    check(events == E2E_ROUNDS * sensors.size() + 1, "metrics: %g events merged", events);
+    check(updates == (double)positions, "metrics: %g localization updates, %zu fixes printed",
+          updates, positions);
+}
+
+// ============================================================
+// Main
+// ============================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [-c COLLECTOR] [-v]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* binary = ".pio/build/collector/program";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:vh")) != -1) {
+        switch (opt) {
+        case 'c': binary = optarg; break;
+        case 'v': verbose = true; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (access(binary, X_OK) != 0) {
+        fprintf(stderr, "%s: not executable (build the collector env first)\n", binary);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    checkClockDrift();
+
+    // The third name needs escaping in both JSON and metric labels
+    std::vector<FakeSensor> sensors = {
+        { "lobby", 0.0, 0.0, 1000 },
+        { "hall", 8.0, 0.0, 52000 },
+        { "back\"door", 0.0, 6.0, 123456 },
+    };
+    for (FakeSensor& s : sensors) {
+        if (!openPty(s)) {
+            perror("pty");
+            return 1;
+        }
+    }
+
+    Collector collector;
+    if (!startCollector(collector, binary, sensors)) {
+        perror("collector");
+        return 1;
+    }
+
+    // Ready once every port shows up; the collector flushes its input on open
+    bool ready = false;
+    uint64_t deadline = monotonicMs() + E2E_TIMEOUT_MS;
+    while (!ready && monotonicMs() < deadline) {
+        std::string page = scrape(collector.port);
+        ready = !page.empty();
+        for (const FakeSensor& s : sensors) {
+            ready = ready && metric(page, sensorSeries("glasshole_sensor_up", s)) == 1;
+        }
+        if (!ready) sleepMs(50);
+    }
+    check(ready, "collector: listening with %zu ports connected", sensors.size());
+    if (!ready) {
+        stopCollector(collector);
+        printf("collector-e2e: FAILED (collector did not start)\n");
+        return 1;
+    }
+
+    // An idle connection must not hold up anything else
+    int idle = connectMetrics(collector.port);
+
+    char line[320];
+    for (size_t i = 0; i < sensors.size(); i++) {
+        for (const char* text : BANNER_LINES) sendLine(sensors[i], text);
+        sendLine(sensors[i], "");
+        snprintf(line, sizeof(line),
+                 "{\"type\":\"boot\",\"board\":\"ESP32-S3\",\"env\":\"esp32s3\",\"version\":\"1.0.0\","
+                 "\"bootMs\":{\"setup\":35,\"bleReady\":180,\"scanStart\":210,\"firstAdvert\":260,\"firstDetection\":null}}");
+        sendLine(sensors[i], line);
+        snprintf(line, sizeof(line),
+                 "{\"type\":\"status\",\"uptime\":%u,\"freeHeap\":%zu,\"totalScans\":3,"
+                 "\"totalDetections\":0,\"trackedDevices\":0,\"board\":\"ESP32-S3\"}",
+                 sensors[i].bootTs / 1000, 200000 + i);
+        sendLine(sensors[i], line);
+    }
+    // Truncated, and a number too long for int64: both parse errors
+    sendLine(sensors[1], "{\"type\":\"detection\",\"mac\":");
+    sendLine(sensors[1], "{\"type\":\"detection\",\"mac\":\"7c:2a:9e:01:02:03\","
+                         "\"rssi\":-9223372036854775808123,\"ts\":1}");
+
+    for (int round = 0; round < E2E_ROUNDS; round++) {
+        for (const FakeSensor& s : sensors) {
+            snprintf(line, sizeof(line),
+                     "{\"type\":\"detection\",\"mac\":\"7c:2a:9e:01:02:03\",\"company\":\"Meta\","
+                     "\"product\":\"Ray-Ban Meta\",\"reason\":\"Company ID\",\"rssi\":%d,"
+                     "\"hasCamera\":true,\"tier\":1,\"companyId\":\"0x01AB\",\"ts\":%u}",
+                     expectedRssi(s), s.bootTs + round * E2E_ROUND_MS);
+            sendLine(s, line);
+        }
+        sleepMs(E2E_ROUND_MS);
+    }
+
+    // Same device over Wi-Fi: counted, but must leave the fix alone
+    const FakeSensor& heard = sensors[E2E_WIFI_SENSOR];
+    snprintf(line, sizeof(line),
+             "{\"type\":\"detection\",\"mac\":\"7c:2a:9e:01:02:03\",\"company\":\"Meta\","
+             "\"product\":\"Smart Glasses (OUI match)\",\"reason\":\"OUI prefix 7C:2A:9E (Meta Platforms Technologies)\","
+             "\"rssi\":%d,\"hasCamera\":true,\"tier\":1,\"ts\":%u,\"source\":\"wifi\","
+             "\"channel\":6,\"frame\":\"probe_req\"}",
+             E2E_WIFI_RSSI, heard.bootTs + E2E_ROUNDS * E2E_ROUND_MS);
+    sendLine(heard, line);
+    sleepMs(200);
+
+    std::string page = scrape(collector.port);
+    std::vector<std::string> lines = collectorLines(collector);
+    size_t positions = 0;
+    checkOutput(lines, sensors, positions);
+    checkMetrics(page, sensors, positions);
+
+    // The idle client is dropped after COLLECTOR_SEND_TIMEOUT_MS
+    bool dropped = false;
+    struct pollfd pfd = { idle, POLLIN, 0 };
+    char b;
+    if (idle >= 0 && poll(&pfd, 1, COLLECTOR_SEND_TIMEOUT_MS + 1500) == 1) {
+        dropped = read(idle, &b, 1) <= 0;
+    }
+    check(dropped, "metrics: idle connection closed by the collector");
+    if (idle >= 0) close(idle);
+
+    check(stopCollector(collector), "collector: clean exit on SIGTERM");
+    for (FakeSensor& s : sensors) {
+        close(s.master);
+        close(s.slave);
+    }
+
+    if (failures) {
+        printf("collector-e2e: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    printf("collector-e2e: all checks passed (%zu output lines, %zu position fixes)\n",
+           lines.size(), positions);
+    return 0;
+}
@@ -0,0 +1,442 @@
+/*
+ * ESP-GlassHole — Detection Journal Benchmark
+ *
+ * Runs the firmware's journal (journal.h) on a simulated NOR flash
+ * partition fed by detections from synthetic crowd traffic, and reports:
+ *
+ *   write    cost per detection: host time for append/flush, flash
+ *            operations, and modelled on-device flash time
+ *   wear     erase counts per sector after the ring has wrapped
+ *   mount    index rebuild over a full partition
+ *   query    time-range and per-company queries over a full partition
+ *   recovery remount after power cuts at random points during writes
+ *   clock    journal time stays in order across the millis() rollover
+ *
+ * Device times come from the timing model in sim_flash.h. Exits non-zero
+ * if the clock check fails.
+ *
+ * Usage:
+ *   glasshole-journal-bench [-p PARTITION_KB] [-w WRAPS] [-s SEED] [-c CUTS]
+ *
+ * License: AGPL-3.0
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "detection.h"
+#include "journal.h"
+#include "pipeline.h"
+#include "sim_flash.h"
+#include "traffic_gen.h"
+
+typedef DetectionJournal<SimFlash> Journal;
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// ============================================================
+// Detection Source
+// ============================================================
+
+struct Detection {
+    uint8_t         mac[6];
+    int             rssi;
+    uint32_t        timeMs;
+    DetectionResult result;
+};
+
+// One lap of crowd traffic through the detection pipeline; replayed with a
+// time offset to produce as many detections as needed.
+static std::vector<Detection> collectDetections(uint64_t seed, uint32_t& spanMs) {
+    TrafficConfig cfg;
+    cfg.advertsPerSecond = 5000;
+    cfg.seed = seed;
+    TrafficGenerator gen(cfg);
+
+    std::vector<SyntheticAdvert> adverts;
+    gen.generate(adverts, 500000);
+    spanMs = adverts.back().timeMs + 1;
+
+    GlassholePipeline::State* tracker = new GlassholePipeline::State();
+    std::vector<Detection> out;
+    for (const SyntheticAdvert& adv : adverts) {
+        Detection d = {};
+        if (!processAdvertisement(adv, *tracker, adv.timeMs, d.result)) continue;
+        memcpy(d.mac, adv.mac(), 6);
+        d.rssi = adv.rssi();
+        d.timeMs = adv.timeMs;
+        out.push_back(d);
+    }
+    delete tracker;
+    return out;
+}
+
+// Feeds detections the way the firmware does: append from the callback,
+// service() from loop() every 10 ms of simulated time.
+struct Feeder {
+    const std::vector<Detection>& detections;
+    uint32_t spanMs;
+    size_t   next = 0;
+    uint32_t lapMs = 0;
+    uint32_t lastServiceMs = 0;
+    uint32_t flushDueMs = 0;
+
+    uint64_t appendNs = 0;
+    uint64_t serviceNs = 0;
+    uint64_t maxServiceNs = 0;
+    double   maxServiceDeviceUs = 0;
+
+    Feeder(const std::vector<Detection>& d, uint32_t span) : detections(d), spanMs(span) {}
+
+    void feed(Journal& journal, SimFlash& flash, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Detection& d = detections[next];
+            uint32_t t = lapMs + d.timeMs;
+
+            // Idle loop() passes only move the flush timer, so jump straight
+            // to the last tick before t, stopping at a due timed flush
+            while (t - lastServiceMs >= 10) {
+                uint32_t tick = t - (t - lastServiceMs) % 10;
+                if (journal.pending() && flushDueMs > lastServiceMs && flushDueMs < tick) {
+                    tick = flushDueMs;
+                }
+                lastServiceMs = tick;
+                service(journal, flash, tick);
+            }
+
+            JournalRecord rec = makeJournalRecord(d.mac, d.rssi, d.result, t);
+            if (!journal.pending()) flushDueMs = lastServiceMs + JOURNAL_FLUSH_MS;
+            uint64_t a = nowNs();
+            journal.append(rec);
+            appendNs += nowNs() - a;
+
+            if (++next == detections.size()) {
+                next = 0;
+                lapMs += spanMs;
+            }
+        }
+        service(journal, flash, lastServiceMs + JOURNAL_FLUSH_MS);
+        journal.flush();
+    }
+
+    void service(Journal& journal, SimFlash& flash, uint32_t ms) {
+        double before = flash.stats().estimatedUs;
+        uint64_t a = nowNs();
+        journal.service(ms);
+        uint64_t d = nowNs() - a;
+        serviceNs += d;
+        if (d > maxServiceNs) maxServiceNs = d;
+        double dev = flash.stats().estimatedUs - before;
+        if (dev > maxServiceDeviceUs) maxServiceDeviceUs = dev;
+    }
+};
+
+// ============================================================
+// Benchmarks
+// ============================================================
+
+static void benchWrite(SimFlash& flash, Journal& journal, Feeder& feeder, size_t records) {
+    flash.resetStats();
+    feeder.feed(journal, flash, records);
+    const SimFlashStats& fs = flash.stats();
+    JournalStats js = journal.stats();
+
+    printf("Write: %zu detections into %u sectors (%u records each)\n",
+           records, js.sectors, JOURNAL_RECORDS_PER_SECTOR);
+    printf("  host        %.1f ns/append, %.1f ns/detection in service(), worst service() %.1f us\n",
+           (double)feeder.appendNs / records, (double)feeder.serviceNs / records,
+           feeder.maxServiceNs / 1000.0);
+    printf("  flash ops   %.3f writes, %.3f page programs, %.1f bytes, %.4f erases per detection\n",
+           (double)fs.programs / records, (double)fs.pagePrograms / records,
+           (double)fs.programBytes / records, (double)fs.erases / records);
+    printf("  device est  %.1f us flash time per detection, worst loop() stall %.1f ms\n",
+           fs.estimatedUs / records, feeder.maxServiceDeviceUs / 1000.0);
+    printf("  journal     %u flushes, %u erases, %u dropped, %u write errors\n",
+           js.flushes, js.erases, js.dropped, js.writeErrors);
+
+    const std::vector<uint32_t>& erases = flash.sectorErases();
+    auto mm = std::minmax_element(erases.begin(), erases.end());
+    printf("Wear: sector erases min %u max %u (%.1f laps of the ring)\n\n",
+           *mm.first, *mm.second, (double)fs.erases / erases.size());
+}
+
+static void benchMount(SimFlash& flash) {
+    Journal* journal = new Journal(flash);
+    flash.resetStats();
+    uint64_t a = nowNs();
+    journal->mount();
+    uint64_t ns = nowNs() - a;
+    const SimFlashStats& fs = flash.stats();
+    printf("Mount: %.1f us host, %llu reads (%llu bytes), device est %.2f ms\n\n",
+           ns / 1000.0, (unsigned long long)fs.reads, (unsigned long long)fs.readBytes,
+           fs.estimatedUs / 1000.0);
+    delete journal;
+}
+
+struct QueryCase {
+    const char* name;
+    uint32_t    from;
+    uint32_t    to;
+    int         company;
+};
+
+static void benchQueries(SimFlash& flash, Journal& journal) {
+    JournalStats js = journal.stats();
+    uint32_t span = js.newestTime - js.oldestTime;
+
+    // Most and least frequent company in the journal
+    std::map<int, uint32_t> perCompany;
+    journal.query(0, UINT32_MAX, JOURNAL_ANY_COMPANY, [&](const JournalRecord& rec) {
+        if (rec.companyIndex != COMPANY_INDEX_NONE) perCompany[rec.companyIndex]++;
+        return true;
+    });
+    int common = JOURNAL_ANY_COMPANY, rare = JOURNAL_ANY_COMPANY;
+    for (auto& kv : perCompany) {
+        if (common < 0 || kv.second > perCompany[common]) common = kv.first;
+        if (rare < 0 || kv.second < perCompany[rare]) rare = kv.first;
+    }
+
+    std::vector<QueryCase> cases = {
+        { "all",                 0, UINT32_MAX, JOURNAL_ANY_COMPANY },
+        { "last 1% of time",     js.newestTime - span / 100, UINT32_MAX, JOURNAL_ANY_COMPANY },
+        { "middle 10% of time",  js.oldestTime + span * 45 / 100,
+                                 js.oldestTime + span * 55 / 100, JOURNAL_ANY_COMPANY },
+    };
+    if (common >= 0) cases.push_back({ "common company",      0, UINT32_MAX, common });
+    if (rare >= 0)   cases.push_back({ "rare company",        0, UINT32_MAX, rare });
+    if (common >= 0) cases.push_back({ "company + last 1%",   js.newestTime - span / 100,
+                                       UINT32_MAX, common });
+
+    printf("Query: %u records, journal time %u..%u s\n", js.records, js.oldestTime, js.newestTime);
+    printf("%-20s %8s %8s %8s %9s %10s %12s\n",
+           "query", "matched", "scanned", "skipped", "read", "host us", "device est ms");
+    printf("%s\n", std::string(81, '-').c_str());
+    for (const QueryCase& qc : cases) {
+        flash.resetStats();
+        // Repeat for a stable host figure
+        int reps = 0;
+        JournalQueryStats qs = {};
+        uint64_t a = nowNs(), elapsed;
+        do {
+            qs = journal.query(qc.from, qc.to, qc.company, [](const JournalRecord&) { return true; });
+            reps++;
+            elapsed = nowNs() - a;
+        } while (elapsed < 50000000ull);
+        printf("%-20s %8u %8u %8u %9u %10.1f %12.2f\n",
+               qc.name, qs.recordsMatched, qs.sectorsScanned, qs.sectorsSkipped, qs.recordsRead,
+               elapsed / 1000.0 / reps, flash.stats().estimatedUs / 1000.0 / reps);
+
+        // The firmware replies a few records per loop() pass
+        JournalCursor c = journal.startQuery(qc.from, qc.to, qc.company);
+        uint32_t stepped = 0, passes = 0;
+        do {
+            passes++;
+        } while (journal.resume(c, JOURNAL_QUERY_CHUNK, [&](const JournalRecord&) {
+            stepped++;
+            return true;
+        }));
+        if (stepped != qs.recordsMatched) {
+            printf("  resumed %u records at a time over %u passes: %u matched, MISMATCH\n",
+                   JOURNAL_QUERY_CHUNK, passes, stepped);
+        }
+    }
+    printf("\n");
+}
+
+// Cut power at a random byte during writes, remount, and check that every
+// record flushed before the cut is still readable (unless a wrap reclaimed
+// its sector meanwhile) and the journal keeps appending after it.
+static void benchRecovery(uint32_t partitionBytes, const std::vector<Detection>& detections,
+                          uint32_t spanMs, int cuts, uint64_t seed) {
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ull | 1;
+    auto rand32 = [&]() {
+        rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+        return (uint32_t)((rng * 0x2545F4914F6CDD1DULL) >> 32);
+    };
+
+    int recovered = 0;
+    uint32_t lostTotal = 0;
+    uint32_t reclaimedTotal = 0;
+    for (int c = 0; c < cuts; c++) {
+        SimFlash flash(partitionBytes);
+        Journal* journal = new Journal(flash);
+        journal->mount();
+        Feeder feeder(detections, spanMs);
+
+        // Fill part of the ring (sometimes wrapped), then cut mid-write
+        uint32_t capacity = journal->sectorCount() * JOURNAL_RECORDS_PER_SECTOR;
+        feeder.feed(*journal, flash, rand32() % (capacity * 2) + 1);
+        uint32_t durable = journal->stats().records;
+        std::vector<JournalSectorInfo> before(journal->sectorCount());
+        for (uint32_t s = 0; s < journal->sectorCount(); s++) before[s] = journal->sectorInfo(s);
+        flash.cutPowerAfter(rand32() % (JOURNAL_BATCH_RECORDS * JOURNAL_RECORD_SIZE * 4));
+        feeder.feed(*journal, flash, JOURNAL_BATCH_RECORDS * 4);
+        delete journal;
+
+        // Reboot
+        flash.cutPowerAfter(-1);
+        journal = new Journal(flash);
+        bool ok = journal->mount();
+        uint32_t valid = 0;
+        journal->query(0, UINT32_MAX, JOURNAL_ANY_COMPANY, [&](const JournalRecord&) {
+            valid++;
+            return true;
+        });
+        // A wrap during the interrupted writes erases the oldest sector for
+        // new data; its records are gone by design, not by the cut
+        uint32_t reclaimed = 0;
+        for (uint32_t s = 0; s < journal->sectorCount(); s++) {
+            if (before[s].seq != 0 && journal->sectorInfo(s).seq != before[s].seq) {
+                reclaimed += before[s].count;
+            }
+        }
+        uint32_t kept = durable - reclaimed;
+        if (valid < kept) {
+            ok = false;
+            lostTotal += kept - valid;
+        }
+        reclaimedTotal += reclaimed;
+
+        // Keeps going after the torn write, tagged with the next boot
+        uint8_t boot = journal->boot();
+        Feeder after(detections, spanMs);
+        after.feed(*journal, flash, JOURNAL_BATCH_RECORDS);
+        uint32_t appended = 0;
+        journal->query(0, UINT32_MAX, JOURNAL_ANY_COMPANY, [&](const JournalRecord& rec) {
+            if (rec.boot == boot) appended++;
+            return true;
+        });
+        if (appended != JOURNAL_BATCH_RECORDS || journal->stats().writeErrors) ok = false;
+        delete journal;
+
+        if (ok) recovered++;
+    }
+    printf("Recovery: %d/%d power cuts recovered, %u flushed records lost to cuts; "
+           "%.1f per cut were in the oldest sector, reclaimed by a wrap\n",
+           recovered, cuts, lostTotal, cuts ? (double)reclaimedTotal / cuts : 0.0);
+}
+
+// Runs the journal through millis() wrapping at 2^32 ms (49.7 days of
+// uptime), then reboots it: journal time must keep increasing throughout.
+static bool benchClockWrap(const std::vector<Detection>& detections, uint32_t spanMs) {
+    const uint32_t startMs = 0u - 30000;   // 30 s before the rollover
+    const uint32_t runMs = 60000;
+
+    size_t count = 0;
+    while (count < detections.size() && detections[count].timeMs < runMs) count++;
+
+    SimFlash flash(64 * 1024);
+    Journal* journal = new Journal(flash);
+    journal->mount();
+    // 49.7 idle days: loop() runs throughout, far more often than this
+    for (uint32_t t = 0; t < startMs - (1u << 30); t += 1u << 30) journal->service(t);
+    Feeder feeder(detections, spanMs);
+    feeder.lapMs = startMs;
+    feeder.lastServiceMs = startMs;
+    feeder.feed(*journal, flash, count);
+    uint32_t nowAfter = journal->now(startMs + runMs);
+    delete journal;
+
+    journal = new Journal(flash);
+    journal->mount();
+    Feeder rebooted(detections, spanMs);
+    rebooted.feed(*journal, flash, JOURNAL_BATCH_RECORDS);
+
+    uint32_t records = 0, backwards = 0, prev = 0, first = 0, last = 0;
+    journal->query(0, UINT32_MAX, JOURNAL_ANY_COMPANY, [&](const JournalRecord& rec) {
+        if (records == 0) first = rec.time;
+        else if (rec.time < prev) backwards++;
+        if (rec.boot == 0) last = rec.time;
+        prev = rec.time;
+        records++;
+        return true;
+    });
+    delete journal;
+
+    // Span of the first boot's records against the simulated time fed
+    uint32_t fedS = (detections[count - 1].timeMs - detections[0].timeMs) / 1000;
+    uint32_t span = last - first;
+    bool ok = records == count + JOURNAL_BATCH_RECORDS && backwards == 0 &&
+              span + 1 >= fedS && span <= fedS + 1 && nowAfter >= last;
+    printf("Clock: %u records across the millis() rollover and a reboot, %u out of order, "
+           "%u s spanned (fed %u s)  %s\n", records, backwards, span, fedS, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// ============================================================
+// Main
+// ============================================================
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [-p PARTITION_KB] [-w WRAPS] [-s SEED] [-c CUTS]\n"
+        "  -p  journal partition size in KiB (default 896, as partitions_journal.csv)\n"
+        "  -w  times to wrap the ring before measuring (default 3)\n"
+        "  -s  traffic seed (default 1)\n"
+        "  -c  power-cut recovery trials (default 200)\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t partitionKb = 896;
+    uint32_t wraps = 3;
+    uint64_t seed = 1;
+    int cuts = 200;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:w:s:c:h")) != -1) {
+        switch (opt) {
+        case 'p': partitionKb = strtoul(optarg, nullptr, 10); break;
+        case 'w': wraps = strtoul(optarg, nullptr, 10); break;
+        case 's': seed = strtoull(optarg, nullptr, 10); break;
+        case 'c': cuts = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    uint32_t partitionBytes = partitionKb * 1024;
+    if (partitionBytes / JOURNAL_SECTOR_SIZE < 2 || wraps == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    uint32_t spanMs;
+    std::vector<Detection> detections = collectDetections(seed, spanMs);
+    if (detections.empty()) {
+        fprintf(stderr, "traffic produced no detections\n");
+        return 1;
+    }
+
+    printf("ESP-GlassHole journal benchmark\n");
+    printf("  record %d bytes, sector %d bytes, batch %d records, queue %d, flush %d ms\n",
+           JOURNAL_RECORD_SIZE, JOURNAL_SECTOR_SIZE, JOURNAL_BATCH_RECORDS,
+           JOURNAL_QUEUE_RECORDS, JOURNAL_FLUSH_MS);
+    printf("  RAM: journal object %zu bytes; traffic: %zu detections per %.1f s lap\n\n",
+           sizeof(Journal), detections.size(), spanMs / 1000.0);
+
+    SimFlash flash(partitionBytes);
+    Journal* journal = new Journal(flash);
+    journal->mount();
+    Feeder feeder(detections, spanMs);
+
+    size_t capacity = (size_t)journal->sectorCount() * JOURNAL_RECORDS_PER_SECTOR;
+    benchWrite(flash, *journal, feeder, capacity * wraps);
+    benchMount(flash);
+    benchQueries(flash, *journal);
+    delete journal;
+
+    benchRecovery(partitionBytes, detections, spanMs, cuts, seed);
+    return benchClockWrap(detections, spanMs) ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+/*
+ * ESP-GlassHole — Detection Journal Dump
+ *
+ * Prints the records in a journal partition image as the same JSON lines
+ * the firmware's {"cmd":"journal"} query returns. Read the image off a
+ * unit with:
+ *
+ *   esptool.py read_flash 0x310000 0xE0000 journal.bin
+ *
+ * Usage:
+ *   glasshole-journal-dump [-f FROM] [-t TO] [-c COMPANYID] [-i] IMAGE
+ *
+ *   -f FROM        Oldest journal time to print (seconds)
+ *   -t TO          Newest journal time to print (seconds)
+ *   -c COMPANYID   Only this company, e.g. 0x058E
+ *   -i             Print the sector index instead of records
+ *
+ * License: AGPL-3.0
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ArduinoJson.h>
+
+#include "journal.h"
+#include "journal_json.h"
+#include "sim_flash.h"
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [-f FROM] [-t TO] [-c COMPANYID] [-i] IMAGE\n"
+        "  -f  oldest journal time to print (seconds)\n"
+        "  -t  newest journal time to print (seconds)\n"
+        "  -c  only records for this company ID (hex)\n"
+        "  -i  print the sector index instead of records\n", argv0);
+}
+
+static void printIndex(const DetectionJournal<SimFlash>& journal) {
+    printf("%6s %8s %6s %10s %10s %10s %4s %s\n",
+           "sector", "seq", "count", "minTime", "maxTime", "companies", "tier", "state");
+    for (uint32_t s = 0; s < journal.sectorCount(); s++) {
+        const JournalSectorInfo& info = journal.sectorInfo(s);
+        if (info.seq == 0) continue;
+        printf("%6u %8u %6u %10u %10u 0x%08X 0x%02X %s\n",
+               s, info.seq, info.count, info.minTime, info.maxTime,
+               info.companyMask, info.tierMask, info.sealed ? "sealed" : "open");
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    int company = JOURNAL_ANY_COMPANY;
+    bool indexOnly = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:c:ih")) != -1) {
+        switch (opt) {
+        case 'f': from = strtoul(optarg, nullptr, 10); break;
+        case 't': to = strtoul(optarg, nullptr, 10); break;
+        case 'c':
+            company = journalCompanyIndex<ALL_TIERS_MASK>((uint16_t)strtoul(optarg, nullptr, 16));
+            if (company < 0) {
+                fprintf(stderr, "company ID %s is not in the database\n", optarg);
+                return 2;
+            }
+            break;
+        case 'i': indexOnly = true; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    SimFlash flash;
+    if (!flash.loadImage(argv[optind])) {
+        fprintf(stderr, "cannot read image %s\n", argv[optind]);
+        return 1;
+    }
+    DetectionJournal<SimFlash> journal(flash);
+    if (!journal.mount()) {
+        fprintf(stderr, "image too small for a journal (%u bytes)\n", flash.size());
+        return 1;
+    }
+
+    if (indexOnly) {
+        printIndex(journal);
+    } else {
+        char line[256];
+        journal.query(from, to, company, [&](const JournalRecord& rec) {
+            JsonDocument doc;
+            buildJournalJSON<ALL_TIERS_MASK>(doc, rec);
+            serializeJson(doc, line, sizeof(line));
+            puts(line);
+            return true;
+        });
+    }
+
+    JournalStats st = journal.stats();
+    fprintf(stderr, "%u records in %u/%u sectors, time %u..%u, next boot %u\n",
+            st.records, st.sectorsUsed, st.sectors, st.oldestTime, st.newestTime,
+            journal.boot());
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * ESP-GlassHole — Localization Validation
+ *
+ * Runs the collector's Localizer (localizer.h) against a synthetic room
+ * with known ground truth and fails if accuracy regresses:
+ *
+ *   room       10 x 8 m, four sensors in the corners, each with its own
+ *              true path-loss model (the collector starts from defaults)
+ *   anchors    three reference devices at known positions
+ *   devices    bouncing around the room at walking pace, heard by every
+ *              sensor once a second with Gaussian RSSI noise
+ *
+ * Checks, after a warm-up of half the run:
+ *
+ *   calibration  every sensor's fitted txPower / exponent is near truth
+ *   accuracy     position RMSE against ground truth
+ *   sigma        reported sigma matches the actual error (neither
+ *                overconfident nor useless)
+ *
+ * and reports updates/s on one core. Exits non-zero if a check fails.
+ *
+ * Usage:
+ *   glasshole-localize-bench [-d DEVICES] [-t SECONDS] [-s SEED]
+ *
+ * License: AGPL-3.0
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <random>
+#include <vector>
+
+#include "localizer.h"
+
+// Pass limits for the default run (-d 200 -t 600 -s 1)
+#define CHECK_RMSE_M          1.3
+#define CHECK_TX_POWER_DB     1.5
+#define CHECK_EXPONENT        0.15
+#define CHECK_SIGMA_RATIO_MIN 0.5     // RMSE / RMS sigma
+#define CHECK_SIGMA_RATIO_MAX 1.6
+
+#define ROOM_W           10.0
+#define ROOM_H           8.0
+#define SENSOR_COUNT     4
+#define ANCHOR_COUNT     3
+#define RSSI_NOISE_DB    4.0
+#define DEVICE_SPEED     0.15          // Max metres per report per axis
+#define STEP_MS          100
+
+struct TrueSensor {
+    double x, y;
+    double txPower, exponent;
+};
+
+static const TrueSensor SENSORS[SENSOR_COUNT] = {
+    {  0.0, 0.0, -62.0, 2.2 },
+    { 10.0, 0.0, -57.0, 2.8 },
+    { 10.0, 8.0, -60.0, 2.5 },
+    {  0.0, 8.0, -64.0, 2.0 },
+};
+
+static const double ANCHORS[ANCHOR_COUNT][2] = { { 2, 2 }, { 7, 6 }, { 9, 1 } };
+
+#define ANCHOR_KEY_BASE  0x1000000000ull   // Outside the device key range
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [-d DEVICES] [-t SECONDS] [-s SEED]\n"
+        "  -d  moving devices (default 200)\n"
+        "  -t  simulated seconds (default 600)\n"
+        "  -s  random seed (default 1)\n", argv0);
+}
+
+struct Device {
+    double x, y, vx, vy;
+};
+
+int main(int argc, char** argv) {
+    int deviceCount = 200;
+    int seconds = 600;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:t:s:h")) != -1) {
+        switch (opt) {
+        case 'd': deviceCount = atoi(optarg); break;
+        case 't': seconds = atoi(optarg); break;
+        case 's': seed = strtoul(optarg, nullptr, 10); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (deviceCount <= 0 || seconds < 60) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, RSSI_NOISE_DB);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    auto rssiAt = [&](int s, double x, double y) {
+        double r = hypot(x - SENSORS[s].x, y - SENSORS[s].y);
+        if (r < LOCALIZE_MIN_RANGE_M) r = LOCALIZE_MIN_RANGE_M;
+        double rssi = SENSORS[s].txPower - 10.0 * SENSORS[s].exponent * log10(r) + noise(rng);
+        return (int)lround(rssi);   // Firmware reports whole dBm
+    };
+
+    Localizer loc(SENSOR_COUNT);
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        loc.sites[s].x = SENSORS[s].x;
+        loc.sites[s].y = SENSORS[s].y;
+        loc.sites[s].placed = true;
+    }
+    for (int a = 0; a < ANCHOR_COUNT; a++) {
+        loc.addAnchor(ANCHOR_KEY_BASE + a, ANCHORS[a][0], ANCHORS[a][1]);
+    }
+
+    std::vector<Device> devices(deviceCount);
+    for (Device& d : devices) {
+        d.x = 1.0 + (ROOM_W - 2.0) * uniform(rng);
+        d.y = 1.0 + (ROOM_H - 2.0) * uniform(rng);
+        d.vx = 2.0 * DEVICE_SPEED * (uniform(rng) - 0.5);
+        d.vy = 2.0 * DEVICE_SPEED * (uniform(rng) - 0.5);
+    }
+
+    uint64_t endMs = (uint64_t)seconds * 1000;
+    uint64_t warmupMs = endMs / 2;
+    double errSq = 0.0, sigmaSq = 0.0;
+    uint64_t scored = 0, fixes = 0;
+    uint64_t solveNs = 0;
+
+    for (uint64_t ms = 0; ms < endMs; ms += STEP_MS) {
+        if (ms % 1000 == 0) {
+            for (int a = 0; a < ANCHOR_COUNT; a++) {
+                for (int s = 0; s < SENSOR_COUNT; s++) {
+                    PositionFix fix;
+                    loc.update(ANCHOR_KEY_BASE + a, s, rssiAt(s, ANCHORS[a][0], ANCHORS[a][1]), ms, fix);
+                }
+            }
+        }
+
+        // Each device reports once a second, spread over the steps
+        for (int i = 0; i < deviceCount; i++) {
+            if ((ms / STEP_MS + i) % (1000 / STEP_MS) != 0) continue;
+            Device& d = devices[i];
+            d.x += d.vx;
+            d.y += d.vy;
+            if (d.x < 0.5 || d.x > ROOM_W - 0.5) d.vx = -d.vx;
+            if (d.y < 0.5 || d.y > ROOM_H - 0.5) d.vy = -d.vy;
+
+            for (int s = 0; s < SENSOR_COUNT; s++) {
+                int rssi = rssiAt(s, d.x, d.y);
+                PositionFix fix;
+                uint64_t t0 = nowNs();
+                bool ok = loc.update(i, s, rssi, ms, fix);
+                solveNs += nowNs() - t0;
+                if (!ok) continue;
+                fixes++;
+                if (ms < warmupMs) continue;
+                double ex = fix.x - d.x, ey = fix.y - d.y;
+                errSq += ex * ex + ey * ey;
+                sigmaSq += fix.sigma * fix.sigma;
+                scored++;
+            }
+        }
+    }
+
+    if (scored == 0) {
+        printf("localize-bench: no position fixes\n");
+        return 1;
+    }
+    double rmse = sqrt(errSq / scored);
+    double rmsSigma = sqrt(sigmaSq / scored);
+    double ratio = rmse / rmsSigma;
+    int failures = 0;
+
+    printf("Localization: %d devices, %d sensors, %d anchors, %.0f dB noise, %d s simulated\n",
+           deviceCount, SENSOR_COUNT, ANCHOR_COUNT, RSSI_NOISE_DB, seconds);
+    printf("  %-12s %8s %8s %8s %8s\n", "sensor", "txPower", "true", "n", "true");
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        const PathLossModel& m = loc.sites[s].model;
+        bool ok = fabs(m.txPower - SENSORS[s].txPower) <= CHECK_TX_POWER_DB &&
+                  fabs(m.exponent - SENSORS[s].exponent) <= CHECK_EXPONENT;
+        if (!ok) failures++;
+        printf("  %-12d %8.1f %8.1f %8.2f %8.2f  %s\n", s, m.txPower, SENSORS[s].txPower,
+               m.exponent, SENSORS[s].exponent, ok ? "ok" : "FAIL");
+    }
+
+    bool rmseOk = rmse <= CHECK_RMSE_M;
+    bool sigmaOk = ratio >= CHECK_SIGMA_RATIO_MIN && ratio <= CHECK_SIGMA_RATIO_MAX;
+    failures += !rmseOk + !sigmaOk;
+    printf("  position RMSE %.2f m over %llu fixes (limit %.1f)  %s\n",
+           rmse, (unsigned long long)scored, CHECK_RMSE_M, rmseOk ? "ok" : "FAIL");
+    printf("  RMS sigma %.2f m, RMSE / sigma %.2f (%.1f..%.1f)  %s\n",
+           rmsSigma, ratio, CHECK_SIGMA_RATIO_MIN, CHECK_SIGMA_RATIO_MAX, sigmaOk ? "ok" : "FAIL");
+    printf("  %.2fM updates/s (%llu fixes)\n",
+           solveNs ? (double)deviceCount * SENSOR_COUNT * seconds / (solveNs / 1e9) / 1e6 : 0.0,
+           (unsigned long long)fixes);
+
+    if (failures) {
+        printf("localize-bench: %d check(s) FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+/*
+ * ESP-GlassHole — Wi-Fi Capture Replay
+ *
+ * Replays pcap/pcapng captures through the firmware's Wi-Fi path: the
+ * 802.11 parser and pre-filter the promiscuous callback runs
+ * (WifiCapture), the lock-free queue, and WifiPipeline with the shared
+ * cooldown tracker. Prints the detection lines a unit would have sent,
+ * then per-file counts and the per-frame cost of the callback side.
+ *
+ * With -c it checks the counts of known captures instead (captures/ has
+ * fixtures and their expected counts) and exits non-zero on a mismatch.
+ *
+ * Capture with any monitor-mode adapter, e.g.
+ *
+ *   airodump-ng --write glasses --output-format pcap wlan0mon
+ *   tcpdump -i wlan0mon -w glasses.pcap
+ *
+ * Usage:
+ *   glasshole-pcap-replay [-q] [-s DBM] [-n LAPS] FILE...
+ *   glasshole-pcap-replay -c LIST
+ *
+ *   -q        Counts only, no detection lines
+ *   -s DBM    Signal for frames without radiotap (default 0: passes the gate)
+ *   -n LAPS   Timing laps over the parsed frames (default 20)
+ *   -c LIST   Check captures against the expected counts in LIST
+ *
+ * License: AGPL-3.0
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include <vector>
+
+#include <ArduinoJson.h>
+
+#include "detection.h"
+#include "detection_json.h"
+#include "pipeline.h"
+#include "wifi_sniffer.h"
+#include "pcap_file.h"
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [-q] [-s DBM] [-n LAPS] FILE...\n"
+        "       %s -c LIST\n"
+        "  -q  counts only, no detection lines\n"
+        "  -s  signal for frames without radiotap (default 0)\n"
+        "  -n  timing laps over the parsed frames (default 20)\n"
+        "  -c  check captures against the expected counts in LIST\n", argv0, argv0);
+}
+
+struct ReplayCounts {
+    uint32_t matches;
+    uint32_t alerts;
+    uint32_t byKind[WIFI_FRAME_MGMT + 1];   // Parsed frames per WifiFrameKind
+};
+
+// Runs every frame of one file through capture and pipeline in capture
+// order, with time taken from the capture timestamps
+static ReplayCounts replay(PcapFile& file, int defaultSignal, bool quiet,
+                           std::vector<CapturedFrame>& frames, WifiCaptureStats& cs) {
+    ReplayCounts rc = {};
+    WifiCapture capture;
+    GlassholePipeline::State tracker;
+    uint64_t firstUs = 0;
+    char line[512];
+
+    CapturedFrame cf;
+    while (file.next(cf)) {
+        if (cf.rssi == PCAP_NO_SIGNAL) cf.rssi = defaultSignal;
+        if (frames.empty()) firstUs = cf.timeUs;
+        frames.push_back(cf);
+
+        WifiFrame parsed;
+        if (parse80211(cf.data, cf.len, cf.rssi, cf.channel, parsed)) rc.byKind[parsed.kind]++;
+
+        if (!capture.onFrame(cf.data, cf.len, cf.rssi, cf.channel)) continue;
+
+        uint32_t now = (uint32_t)((cf.timeUs - firstUs) / 1000);
+        WifiFrame frame;
+        while (capture.pop(frame)) {
+            DetectionResult result;
+            if (!WifiPipeline::detect(frame, result)) continue;
+            rc.matches++;
+            if (!WifiPipeline::process(frame, tracker, now, result)) continue;
+            rc.alerts++;
+            if (quiet) continue;
+            JsonDocument doc;
+            buildWifiDetectionJSON(doc, frame, result, now);
+            serializeJson(doc, line, sizeof(line));
+            puts(line);
+        }
+    }
+    cs = capture.stats();
+    return rc;
+}
+
+// Callback-side cost (parse, pre-filter, enqueue, dequeue) over frames
+// already in memory
+static double timeCapture(const std::vector<CapturedFrame>& frames, int laps) {
+    if (frames.empty() || laps <= 0) return 0.0;
+    WifiCapture capture;
+    WifiFrame frame;
+    uint64_t start = nowNs();
+    for (int lap = 0; lap < laps; lap++) {
+        for (const CapturedFrame& cf : frames) {
+            capture.onFrame(cf.data, cf.len, cf.rssi, cf.channel);
+            while (capture.pop(frame)) {}
+        }
+    }
+    return (double)(nowNs() - start) / ((double)frames.size() * laps);
+}
+
+// ============================================================
+// Fixture Check
+// ============================================================
+// Each line of LIST names a capture (relative to LIST) and the counts it
+// must produce with the default config.h:
+//
+//   sniffer.pcap  records=15 bad_fcs=1 parsed=13 weak=1 ...
+//
+// Keys not given are not checked. Blank lines and # comments are skipped.
+
+struct CheckCount {
+    const char* key;
+    uint32_t    value;
+};
+
+// Returns the number of mismatched counts, or -1 if the line is invalid
+static int checkCapture(const std::string& path, char* expected, int defaultSignal) {
+    PcapFile file;
+    if (!file.open(path.c_str())) {
+        printf("%s: not a pcap/pcapng capture\n", path.c_str());
+        return -1;
+    }
+    std::vector<CapturedFrame> frames;
+    WifiCaptureStats cs;
+    ReplayCounts rc = replay(file, defaultSignal, true, frames, cs);
+    const PcapFileStats& fs = file.stats();
+
+    const CheckCount counts[] = {
+        { "records",    fs.records },
+        { "frames",     fs.frames },
+        { "bad_fcs",    fs.badFcs },
+        { "malformed",  fs.malformed },
+        { "parsed",     cs.parsed },
+        { "weak",       cs.weak },
+        { "rejected",   cs.rejected },
+        { "candidates", cs.candidates },
+        { "dropped",    cs.dropped },
+        { "matched",    rc.matches },
+        { "alerts",     rc.alerts },
+        { "cooldown",   rc.matches - rc.alerts },
+    };
+
+    int mismatches = 0;
+    for (char* tok = strtok(expected, " \t"); tok; tok = strtok(nullptr, " \t")) {
+        char* eq = strchr(tok, '=');
+        const CheckCount* count = nullptr;
+        if (eq) {
+            *eq = 0;
+            for (const CheckCount& c : counts) {
+                if (strcmp(c.key, tok) == 0) count = &c;
+            }
+        }
+        if (!count) {
+            printf("%s: unknown count '%s'\n", path.c_str(), tok);
+            return -1;
+        }
+        uint32_t want = strtoul(eq + 1, nullptr, 10);
+        if (count->value != want) {
+            printf("%s: %s %u, expected %u\n", path.c_str(), count->key, count->value, want);
+            mismatches++;
+        }
+    }
+    printf("%-40s %s\n", path.c_str(), mismatches ? "FAIL" : "ok");
+    return mismatches;
+}
+
+static int checkCaptures(const char* listPath, int defaultSignal) {
+    FILE* list = fopen(listPath, "r");
+    if (!list) {
+        perror(listPath);
+        return 2;
+    }
+    std::string dir(listPath);
+    size_t slash = dir.rfind('/');
+    dir = slash == std::string::npos ? "" : dir.substr(0, slash + 1);
+
+    int failed = 0, checked = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "#\r\n")] = 0;
+        char* name = line + strspn(line, " \t");
+        if (!*name) continue;
+        char* expected = name + strcspn(name, " \t");
+        if (*expected) *expected++ = 0;
+        checked++;
+        if (checkCapture(dir + name, expected, defaultSignal) != 0) failed++;
+    }
+    fclose(list);
+
+    if (checked == 0) {
+        printf("%s: no captures listed\n", listPath);
+        return 2;
+    }
+    if (failed) {
+        printf("pcap-replay: %d of %d captures FAILED\n", failed, checked);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    bool quiet = false;
+    int defaultSignal = 0;
+    int laps = 20;
+    const char* checkList = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "qs:n:c:h")) != -1) {
+        switch (opt) {
+        case 'q': quiet = true; break;
+        case 's': defaultSignal = atoi(optarg); break;
+        case 'n': laps = atoi(optarg); break;
+        case 'c': checkList = optarg; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (checkList) return checkCaptures(checkList, defaultSignal);
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    fprintf(stderr, "Wi-Fi pipeline: oui=%d ssid=%d, RSSI gate %d dBm, cooldown %s, %d OUI prefixes\n",
+            PIPELINE_WIFI_OUI, PIPELINE_WIFI_SSID, WIFI_RSSI_THRESHOLD,
+            ENABLE_COOLDOWN ? "on" : "off", (int)OuiTable::SIZE);
+
+    int status = 0;
+    for (int i = optind; i < argc; i++) {
+        PcapFile file;
+        if (!file.open(argv[i])) {
+            fprintf(stderr, "%s: not a pcap/pcapng capture\n", argv[i]);
+            status = 1;
+            continue;
+        }
+
+        std::vector<CapturedFrame> frames;
+        WifiCaptureStats cs;
+        ReplayCounts rc = replay(file, defaultSignal, quiet, frames, cs);
+        const PcapFileStats& fs = file.stats();
+        double ns = timeCapture(frames, laps);
+
+        fprintf(stderr, "%s (%s)\n", argv[i], file.isPcapng() ? "pcapng" : "pcap");
+        fprintf(stderr, "  records %u, 802.11 frames %u, other link types %u, bad FCS %u, malformed %u\n",
+                fs.records, fs.frames, fs.unsupported, fs.badFcs, fs.malformed);
+        fprintf(stderr, "  parsed %u:", cs.parsed);
+        for (int k = 0; k <= WIFI_FRAME_MGMT; k++) {
+            fprintf(stderr, " %s %u", wifiFrameKindName(k), rc.byKind[k]);
+        }
+        fprintf(stderr, "\n  below RSSI gate %u, rejected %u, pre-filter passed %u (%.1f%%)\n",
+                cs.weak, cs.rejected, cs.candidates,
+                cs.parsed ? 100.0 * cs.candidates / cs.parsed : 0.0);
+        fprintf(stderr, "  matched %u, alerts %u, cooldown %u\n",
+                rc.matches, rc.alerts, rc.matches - rc.alerts);
+        fprintf(stderr, "  callback path %.1f ns/frame over %d laps\n", ns, laps);
+    }
+    return status;
+}